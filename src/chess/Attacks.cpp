@@ -0,0 +1,310 @@
+#include "Attacks.hpp"
+#include "Board.hpp"
+
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER) && defined(CHESS_PEXT_AVAILABLE)
+#include <intrin.h>
+#endif
+
+using namespace chess;
+
+static constexpr std::pair<int, int> direction_offsets[] = {
+  {0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1},
+};
+
+static constexpr bool is_within_board(int x, int y) {
+  return (x >= 0 && x < 8) && (y >= 0 && y < 8);
+}
+
+/// Walks from `square` in the direction (dx, dy) and collects fields until it leaves the board or
+/// hits an occupied field.
+static constexpr Bitboard trace_ray(int square, int dx, int dy, Bitboard occupied) {
+  Bitboard result = 0;
+
+  int x = square % 8 + dx;
+  int y = square / 8 + dy;
+
+  while (is_within_board(x, y)) {
+    const auto bit = bitboards::from_square(x + y * 8);
+    result |= bit;
+
+    if (occupied & bit) {
+      break;
+    }
+
+    x += dx;
+    y += dy;
+  }
+
+  return result;
+}
+
+template <size_t N>
+static constexpr std::array<Bitboard, 64>
+make_leaper_table(const std::pair<int, int> (&offsets)[N]) {
+  std::array<Bitboard, 64> table{};
+
+  for (int square = 0; square < 64; ++square) {
+    for (const auto& [dx, dy] : offsets) {
+      const int x = square % 8 + dx;
+      const int y = square / 8 + dy;
+
+      if (is_within_board(x, y)) {
+        table[square] |= bitboards::from_square(x + y * 8);
+      }
+    }
+  }
+
+  return table;
+}
+
+static constexpr std::pair<int, int> knight_offsets[] = {
+  {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2},
+};
+
+static constexpr std::pair<int, int> white_pawn_offsets[] = {{-1, 1}, {1, 1}};
+static constexpr std::pair<int, int> black_pawn_offsets[] = {{-1, -1}, {1, -1}};
+
+const std::array<Bitboard, 64> attacks::detail::knight_table = make_leaper_table(knight_offsets);
+const std::array<Bitboard, 64> attacks::detail::king_table = make_leaper_table(direction_offsets);
+
+const std::array<std::array<Bitboard, 64>, 3> attacks::detail::pawn_table = {
+  std::array<Bitboard, 64>{},
+  make_leaper_table(white_pawn_offsets),
+  make_leaper_table(black_pawn_offsets),
+};
+
+static_assert(size_t(Color::White) == 1 && size_t(Color::Black) == 2,
+              "Pawn attack table layout depends on `Color` values");
+
+/// Builds tables of fields between every pair of aligned squares and of entire lines going through
+/// them. Directions in `direction_offsets` are ordered so that `(d + 4) % 8` is the opposite one.
+static constexpr auto line_tables = [] {
+  struct {
+    std::array<std::array<Bitboard, 64>, 64> between{};
+    std::array<std::array<Bitboard, 64>, 64> line{};
+  } result;
+
+  for (int from = 0; from < 64; ++from) {
+    for (int direction = 0; direction < 8; ++direction) {
+      const auto [dx, dy] = direction_offsets[direction];
+      const auto [odx, ody] = direction_offsets[(direction + 4) % 8];
+
+      const auto ray = trace_ray(from, dx, dy, 0);
+      const auto line = ray | trace_ray(from, odx, ody, 0) | bitboards::from_square(from);
+
+      auto targets = ray;
+      while (targets) {
+        const int to = bitboards::pop_square(targets);
+        const auto to_bit = bitboards::from_square(to);
+
+        result.between[from][to] = trace_ray(from, dx, dy, to_bit) & ~to_bit;
+        result.line[from][to] = line;
+      }
+    }
+  }
+
+  return result;
+}();
+
+const std::array<std::array<Bitboard, 64>, 64> attacks::detail::between_table =
+  line_tables.between;
+const std::array<std::array<Bitboard, 64>, 64> attacks::detail::line_table = line_tables.line;
+
+static constexpr std::pair<int, int> rook_directions[] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+static constexpr std::pair<int, int> bishop_directions[] = {{1, 1}, {1, -1}, {-1, -1}, {-1, 1}};
+
+template <size_t N>
+static Bitboard trace_slider(int square, Bitboard occupied,
+                             const std::pair<int, int> (&directions)[N]) {
+  Bitboard result = 0;
+
+  for (const auto& [dx, dy] : directions) {
+    result |= trace_ray(square, dx, dy, occupied);
+  }
+
+  return result;
+}
+
+/// Small xorshift64* generator. It's seeded with constants so the same magics are found on every
+/// startup.
+class MagicRandom {
+  uint64_t state;
+
+public:
+  explicit MagicRandom(uint64_t seed) : state(seed) {}
+
+  uint64_t next() {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dull;
+  }
+
+  /// Magic multipliers with few set bits are much more likely to work.
+  uint64_t next_sparse() { return next() & next() & next(); }
+};
+
+/// Finds a magic multiplier for every square and fills `table` with attacks for every relevant
+/// occupancy. `table` must be large enough to hold attacks for all 64 squares.
+template <size_t N>
+static std::array<attacks::detail::Magic, 64>
+find_magics(Bitboard* table, const std::pair<int, int> (&directions)[N]) {
+  std::array<attacks::detail::Magic, 64> magics{};
+
+  // Seeds which are known to find magics for every rank quickly. This keeps startup time low.
+  constexpr uint64_t seeds[8] = {728, 10316, 55013, 32803, 12281, 15100, 16645, 255};
+
+  std::vector<Bitboard> occupancies;
+  std::vector<Bitboard> references;
+  std::vector<uint32_t> epochs;
+  uint32_t epoch = 0;
+
+  for (int square = 0; square < 64; ++square) {
+    auto& magic = magics[square];
+
+    // Pieces on the board edge never block anything behind them so they are not relevant.
+    const auto rank = bitboards::rank_1 << (8 * (square / 8));
+    const auto file = bitboards::file_a << (square % 8);
+    const auto edges = ((bitboards::rank_1 | bitboards::rank_8) & ~rank) |
+                       ((bitboards::file_a | bitboards::file_h) & ~file);
+
+    magic.mask = trace_slider(square, 0, directions) & ~edges;
+    magic.shift = 64 - bitboards::count(magic.mask);
+    magic.attacks = table;
+
+    // Enumerate all subsets of the mask.
+    occupancies.clear();
+    references.clear();
+
+    Bitboard occupied = 0;
+    do {
+      occupancies.push_back(occupied);
+      references.push_back(trace_slider(square, occupied, directions));
+
+      occupied = (occupied - magic.mask) & magic.mask;
+    } while (occupied);
+
+    const auto size = occupancies.size();
+    epochs.assign(size, 0);
+
+    // Try random multipliers until one maps every occupancy without destructive collisions.
+    MagicRandom random(seeds[square / 8]);
+
+    while (true) {
+      magic.multiplier = random.next_sparse();
+      if (bitboards::count((magic.mask * magic.multiplier) >> 56) < 6) {
+        continue;
+      }
+
+      epoch++;
+
+      bool valid = true;
+      for (size_t i = 0; i < size && valid; ++i) {
+        const auto index = ((occupancies[i] & magic.mask) * magic.multiplier) >> magic.shift;
+
+        if (epochs[index] < epoch) {
+          epochs[index] = epoch;
+          table[index] = references[i];
+        } else if (table[index] != references[i]) {
+          valid = false;
+        }
+      }
+
+      if (valid) {
+        break;
+      }
+    }
+
+    table += size;
+  }
+
+  return magics;
+}
+
+static std::array<Bitboard, 0x19000> rook_table;
+static std::array<Bitboard, 0x1480> bishop_table;
+
+const std::array<attacks::detail::Magic, 64> attacks::detail::rook_magics =
+  find_magics(rook_table.data(), rook_directions);
+const std::array<attacks::detail::Magic, 64> attacks::detail::bishop_magics =
+  find_magics(bishop_table.data(), bishop_directions);
+
+static bool cpu_supports_bmi2() {
+#if !defined(CHESS_PEXT_AVAILABLE)
+  return false;
+#elif defined(_MSC_VER)
+  int info[4];
+
+  __cpuidex(info, 0, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+
+  // EBX bit 8 of leaf 7 indicates BMI2 support.
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 8)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("bmi2");
+#endif
+}
+
+static std::array<Bitboard, 0x19000> pext_rook_table;
+static std::array<Bitboard, 0x1480> pext_bishop_table;
+
+std::array<const Bitboard*, 64> attacks::detail::pext_rook_attacks;
+std::array<const Bitboard*, 64> attacks::detail::pext_bishop_attacks;
+
+/// Fills `table` with attacks indexed by PEXT of the occupancy. Relevant occupancy masks are shared
+/// with the magic tables.
+template <size_t N>
+static void fill_pext_table(Bitboard* table, const std::array<attacks::detail::Magic, 64>& magics,
+                            std::array<const Bitboard*, 64>& square_attacks,
+                            const std::pair<int, int> (&directions)[N]) {
+  for (int square = 0; square < 64; ++square) {
+    const auto mask = magics[square].mask;
+
+    Bitboard occupied = 0;
+    do {
+      table[attacks::detail::pext(occupied, mask)] = trace_slider(square, occupied, directions);
+      occupied = (occupied - mask) & mask;
+    } while (occupied);
+
+    square_attacks[square] = table;
+    table += size_t(1) << bitboards::count(mask);
+  }
+}
+
+static const bool pext_tables_built = [] {
+  if (!cpu_supports_bmi2()) {
+    return false;
+  }
+
+  fill_pext_table(pext_rook_table.data(), attacks::detail::rook_magics,
+                  attacks::detail::pext_rook_attacks, rook_directions);
+  fill_pext_table(pext_bishop_table.data(), attacks::detail::bishop_magics,
+                  attacks::detail::pext_bishop_attacks, bishop_directions);
+
+  return true;
+}();
+
+attacks::SliderBackend attacks::detail::slider_backend =
+  pext_tables_built ? SliderBackend::Pext : SliderBackend::Magic;
+
+bool attacks::is_slider_backend_supported(SliderBackend backend) {
+  return backend == SliderBackend::Magic || pext_tables_built;
+}
+
+bool attacks::set_slider_backend(SliderBackend backend) {
+  if (!is_slider_backend_supported(backend)) {
+    return false;
+  }
+
+  detail::slider_backend = backend;
+  return true;
+}
+
+attacks::SliderBackend attacks::get_slider_backend() { return detail::slider_backend; }
\ No newline at end of file
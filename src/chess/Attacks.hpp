@@ -0,0 +1,155 @@
+#pragma once
+#include "Bitboard.hpp"
+#include "Board.hpp"
+
+#include <array>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CHESS_PEXT_AVAILABLE
+
+#if defined(_MSC_VER)
+#include <immintrin.h>
+#endif
+#endif
+
+namespace chess {
+
+namespace attacks {
+
+/// Implementation used for rook, bishop and queen attack lookups.
+enum class SliderBackend : uint8_t {
+  /// Portable magic bitboards.
+  Magic,
+
+  /// Tables indexed with the BMI2 PEXT instruction. Available only on x86-64 CPUs with BMI2.
+  Pext,
+};
+
+namespace detail {
+
+extern const std::array<Bitboard, 64> knight_table;
+extern const std::array<Bitboard, 64> king_table;
+
+/// Indexed by the raw value of `Color`. Row for `Color::None` is empty.
+extern const std::array<std::array<Bitboard, 64>, 3> pawn_table;
+
+extern const std::array<std::array<Bitboard, 64>, 64> between_table;
+extern const std::array<std::array<Bitboard, 64>, 64> line_table;
+
+/// Fancy magic bitboard entry for a single square. Relevant occupancy bits are multiplied by the
+/// magic number, which maps every possible blocker configuration to a unique table index.
+struct Magic {
+  Bitboard mask = 0;
+  Bitboard multiplier = 0;
+  const Bitboard* attacks = nullptr;
+  int shift = 0;
+
+  Bitboard lookup(Bitboard occupied) const {
+    return attacks[((occupied & mask) * multiplier) >> shift];
+  }
+};
+
+/// Built during static initialization.
+extern const std::array<Magic, 64> rook_magics;
+extern const std::array<Magic, 64> bishop_magics;
+
+/// Attacks for every square, indexed by PEXT of the relevant occupancy. Filled only if the CPU
+/// supports BMI2.
+extern std::array<const Bitboard*, 64> pext_rook_attacks;
+extern std::array<const Bitboard*, 64> pext_bishop_attacks;
+
+/// Selected during static initialization based on CPUID.
+extern SliderBackend slider_backend;
+
+/// Parallel bit extract. Must be called only if the CPU supports BMI2.
+///
+/// The instruction is emitted directly so this can be inlined into code compiled for baseline
+/// x86-64, which only reaches it after the runtime CPUID check.
+inline uint64_t pext(uint64_t value, uint64_t mask) {
+#if !defined(CHESS_PEXT_AVAILABLE)
+  return value & mask;
+#elif defined(_MSC_VER)
+  return _pext_u64(value, mask);
+#else
+  uint64_t result;
+  asm("pextq %2, %1, %0" : "=r"(result) : "r"(value), "rm"(mask));
+  return result;
+#endif
+}
+
+} // namespace detail
+
+inline Bitboard knight(int square) { return detail::knight_table[square]; }
+inline Bitboard king(int square) { return detail::king_table[square]; }
+
+/// Fields attacked by a pawn of `color` standing on `square`.
+inline Bitboard pawn(Color color, int square) { return detail::pawn_table[size_t(color)][square]; }
+
+/// Fields strictly between `from` and `to` if they share a rank, file or diagonal. Empty otherwise.
+inline Bitboard between(int from, int to) { return detail::between_table[from][to]; }
+
+/// Whole rank, file or diagonal going through both squares. Empty if they aren't aligned.
+inline Bitboard line(int a, int b) { return detail::line_table[a][b]; }
+
+bool is_slider_backend_supported(SliderBackend backend);
+
+/// Overrides the automatically selected backend. Returns false (and keeps the current backend) if
+/// `backend` isn't supported by this CPU. Must not be called while other threads use the tables.
+bool set_slider_backend(SliderBackend backend);
+SliderBackend get_slider_backend();
+
+/// Fields attacked by a rook on `square`, stopping at (and including) the first occupied field in
+/// every direction.
+inline Bitboard rook(int square, Bitboard occupied) {
+  const auto& magic = detail::rook_magics[square];
+  if (detail::slider_backend == SliderBackend::Pext) {
+    return detail::pext_rook_attacks[square][detail::pext(occupied, magic.mask)];
+  }
+
+  return magic.lookup(occupied);
+}
+
+/// Fields attacked by a bishop on `square`, stopping at (and including) the first occupied field in
+/// every direction.
+inline Bitboard bishop(int square, Bitboard occupied) {
+  const auto& magic = detail::bishop_magics[square];
+  if (detail::slider_backend == SliderBackend::Pext) {
+    return detail::pext_bishop_attacks[square][detail::pext(occupied, magic.mask)];
+  }
+
+  return magic.lookup(occupied);
+}
+
+inline Bitboard queen(int square, Bitboard occupied) {
+  return rook(square, occupied) | bishop(square, occupied);
+}
+
+/// Fields attacked by `piece` (other than a pawn, whose attacks depend on its color) standing on
+/// `square`. Attacks are symmetric, so this also gives the fields from which such a piece attacks
+/// `square`.
+inline Bitboard piece(Piece piece, int square, Bitboard occupied) {
+  switch (piece) {
+  case Piece::Bishop:
+    return bishop(square, occupied);
+
+  case Piece::Knight:
+    return knight(square);
+
+  case Piece::Rook:
+    return rook(square, occupied);
+
+  case Piece::Queen:
+    return queen(square, occupied);
+
+  case Piece::King:
+    return king(square);
+
+  default:
+    return 0;
+  }
+}
+
+} // namespace attacks
+
+} // namespace chess
\ No newline at end of file
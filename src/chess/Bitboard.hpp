@@ -0,0 +1,51 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+
+namespace chess {
+
+/// Set of fields on the board. Bit `x + y * 8` represents field (x, y).
+using Bitboard = uint64_t;
+
+namespace bitboards {
+
+constexpr Bitboard file_a = 0x0101010101010101ull;
+constexpr Bitboard file_h = file_a << 7;
+
+constexpr Bitboard rank_1 = 0xffull;
+constexpr Bitboard rank_2 = rank_1 << (8 * 1);
+constexpr Bitboard rank_3 = rank_1 << (8 * 2);
+constexpr Bitboard rank_6 = rank_1 << (8 * 5);
+constexpr Bitboard rank_7 = rank_1 << (8 * 6);
+constexpr Bitboard rank_8 = rank_1 << (8 * 7);
+
+/// Fields of the same color as a1.
+constexpr Bitboard dark_squares = 0xaa55aa55aa55aa55ull;
+
+constexpr Bitboard from_square(int square) { return Bitboard(1) << square; }
+
+constexpr Bitboard north(Bitboard bitboard) { return bitboard << 8; }
+constexpr Bitboard south(Bitboard bitboard) { return bitboard >> 8; }
+constexpr Bitboard east(Bitboard bitboard) { return (bitboard & ~file_h) << 1; }
+constexpr Bitboard west(Bitboard bitboard) { return (bitboard & ~file_a) >> 1; }
+
+constexpr bool contains(Bitboard bitboard, int square) { return (bitboard >> square) & 1; }
+
+constexpr int count(Bitboard bitboard) { return std::popcount(bitboard); }
+
+/// Index of the lowest set square. `bitboard` must not be empty.
+constexpr int lowest_square(Bitboard bitboard) { return std::countr_zero(bitboard); }
+
+/// Index of the highest set square. `bitboard` must not be empty.
+constexpr int highest_square(Bitboard bitboard) { return 63 - std::countl_zero(bitboard); }
+
+/// Removes the lowest set square from `bitboard` and returns its index.
+constexpr int pop_square(Bitboard& bitboard) {
+  const int square = lowest_square(bitboard);
+  bitboard &= bitboard - 1;
+  return square;
+}
+
+} // namespace bitboards
+
+} // namespace chess
\ No newline at end of file
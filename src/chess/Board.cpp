@@ -1,7 +1,9 @@
 #include "Board.hpp"
+#include "Attacks.hpp"
 
 #include <algorithm>
 #include <cctype>
+#include <charconv>
 #include <optional>
 #include <string>
 
@@ -20,205 +22,273 @@ Color chess::other_color(Color color) {
   }
 }
 
-static std::optional<Position> find_piece(const Board& board, Color color, Piece piece) {
-  for (int y = 0; y < 8; ++y) {
-    for (int x = 0; x < 8; ++x) {
-      const auto field = board.get_field(x, y);
+/// Properties of the side to move known at compile time. Generators and `make_move` are
+/// instantiated for both colors, so none of these branch inside their loops.
+template <Color Us> struct Side {
+  constexpr static Color them = Us == Color::White ? Color::Black : Color::White;
 
-      if (field.piece == piece && field.color == color) {
-        return Position(x, y);
-      }
-    }
+  /// Change of `y` after a single pawn push.
+  constexpr static int pawn_direction = Us == Color::White ? 1 : -1;
+
+  /// Rank reached by a single push of a pawn which can still move by 2 places.
+  constexpr static Bitboard double_push_rank =
+    Us == Color::White ? bitboards::rank_3 : bitboards::rank_6;
+
+  constexpr static Bitboard promotion_rank =
+    Us == Color::White ? bitboards::rank_8 : bitboards::rank_1;
+
+  /// `y` of en passant fields on which this side can capture. Field skipped by an enemy pawn is
+  /// on the third rank from the enemy's side.
+  constexpr static int en_passant_y = Us == Color::White ? 5 : 2;
+
+  constexpr static Bitboard pawn_push(Bitboard pawns) {
+    return Us == Color::White ? bitboards::north(pawns) : bitboards::south(pawns);
   }
+};
 
-  return std::nullopt;
-}
+/// Returns en passant field if `Us` can capture on it.
+template <Color Us> static Bitboard en_passant_targets(const Board& board) {
+  const auto en_passant = board.get_en_passant();
+  if (!en_passant || en_passant->y != Side<Us>::en_passant_y) {
+    return 0;
+  }
 
-static bool is_within_board(int x, int y) { return (x >= 0 && x < 8) && (y >= 0 && y < 8); }
+  return bitboards::from_square(en_passant->index());
+}
 
-static int pawn_move_direction(Color color) { return color == Color::White ? 1 : -1; }
+/// Castling rights mask (see `zobrist::castling_*`) derived from `moved` flags of kings and rooks.
+static int castling_rights(const Board& board) {
+  int rights = 0;
 
-static bool simple_movement_to(const Board& board, Position from, Position to, Field field,
-                               std::vector<Move>& moves) {
-  const auto target_field = board.get_field(to);
-  if (target_field.is_solid_piece()) {
-    if (target_field.color != field.color) {
-      moves.push_back(Move{
-        .from = from,
-        .to = to,
-        .captures = true,
-      });
+  for (const auto color : {Color::White, Color::Black}) {
+    const auto king_position = board.get_king_position(color);
+    if (!king_position || board.get_field(*king_position).moved) {
+      continue;
     }
 
-    return false;
-  } else {
-    // En passant is only allowed for pawns so this move never captures (even if we move to
-    // `PawnGhost` piece).
-    moves.push_back(Move{
-      .from = from,
-      .to = to,
-    });
+    const auto king = *king_position;
 
-    return true;
+    const auto has_rook = [&](int x) {
+      const auto field = board.get_field(x, king.y);
+      return !field.moved && field.piece == Piece::Rook && field.color == color;
+    };
+
+    const bool white = color == Color::White;
+    if (has_rook(0)) {
+      rights |= white ? zobrist::castling_white_queen_side : zobrist::castling_black_queen_side;
+    }
+    if (has_rook(7)) {
+      rights |= white ? zobrist::castling_white_king_side : zobrist::castling_black_king_side;
+    }
   }
+
+  return rights;
+}
+
+/// Pieces of `By` attacking `square`, with sliders blocked by `occupied`.
+template <Color By>
+static Bitboard attackers_to(const Board& board, int square, Bitboard occupied) {
+  constexpr auto by = By;
+  const auto queens = board.get_pieces(by, Piece::Queen);
+
+  // Check if any piece of `By` stands on a field from which it could attack `square`. Pawn
+  // attacks are reversed by looking from the perspective of the opposite color.
+  return (attacks::pawn(Side<By>::them, square) & board.get_pieces(by, Piece::Pawn)) |
+         (attacks::knight(square) & board.get_pieces(by, Piece::Knight)) |
+         (attacks::king(square) & board.get_pieces(by, Piece::King)) |
+         (attacks::bishop(square, occupied) & (board.get_pieces(by, Piece::Bishop) | queens)) |
+         (attacks::rook(square, occupied) & (board.get_pieces(by, Piece::Rook) | queens));
 }
 
-static void straight_moves(const Board& board, int x, int y, Field field,
-                           std::vector<Move>& moves) {
-  for (const auto [ox, oy] :
-       {std::pair{1, 0}, std::pair{0, 1}, std::pair{-1, 0}, std::pair{0, -1}}) {
-    int fx = x + ox;
-    int fy = y + oy;
+/// Pieces of any color which are the only blocker between `king_square` and a slider of `By`
+/// aimed at it.
+template <Color By> static Bitboard slider_blockers(const Board& board, int king_square) {
+  constexpr auto by = By;
+  const auto occupied = board.get_occupied();
+  const auto queens = board.get_pieces(by, Piece::Queen);
 
-    while (is_within_board(fx, fy)) {
-      if (!simple_movement_to(board, Position(x, y), Position(fx, fy), field, moves)) {
-        break;
-      }
+  auto snipers = (attacks::rook(king_square, 0) & (board.get_pieces(by, Piece::Rook) | queens)) |
+                 (attacks::bishop(king_square, 0) & (board.get_pieces(by, Piece::Bishop) | queens));
 
-      fx += ox;
-      fy += oy;
+  Bitboard blockers = 0;
+
+  while (snipers) {
+    const auto between = attacks::between(king_square, bitboards::pop_square(snipers)) & occupied;
+    if (bitboards::count(between) == 1) {
+      blockers |= between;
     }
   }
+
+  return blockers;
 }
 
-static void diagonal_moves(const Board& board, int x, int y, Field field,
-                           std::vector<Move>& moves) {
-  for (const auto [ox, oy] :
-       {std::pair{1, 1}, std::pair{-1, -1}, std::pair{1, -1}, std::pair{-1, 1}}) {
-    int fx = x + ox;
-    int fy = y + oy;
+/// Pieces of `Us` which are the only blocker between their king and an enemy slider.
+template <Color Us> static Bitboard pinned_pieces(const Board& board, int king_square) {
+  return slider_blockers<Side<Us>::them>(board, king_square) & board.get_pieces(Us);
+}
 
-    while (is_within_board(fx, fy)) {
-      if (!simple_movement_to(board, Position(x, y), Position(fx, fy), field, moves)) {
-        break;
-      }
+/// Used in place of `MoveList` by generators when only the number of moves is needed. Moves to a
+/// set of fields are counted with a popcount instead of being created one by one.
+struct MoveCounter {
+  size_t count = 0;
 
-      fx += ox;
-      fy += oy;
-    }
+  void push_back(Move) { count++; }
+};
+
+static void add_moves(Position from, Bitboard targets, Bitboard enemies, MoveList& moves) {
+  while (targets) {
+    const int to = bitboards::pop_square(targets);
+
+    const auto flags = bitboards::contains(enemies, to) ? Move::Flags::Capture : Move::Flags::Quiet;
+    moves.push_back(Move(from, Position::from_index(to), flags));
   }
 }
 
-static void knight_moves(const Board& board, int x, int y, Field field, std::vector<Move>& moves) {
-  for (int offset1 : {-2, 2}) {
-    for (int offset2 : {-1, 1}) {
-      {
-        const int fx = x + offset1;
-        const int fy = y + offset2;
-        if (is_within_board(fx, fy)) {
-          simple_movement_to(board, Position(x, y), Position(fx, fy), field, moves);
-        }
-      }
+static void add_moves(Position, Bitboard targets, Bitboard, MoveCounter& counter) {
+  counter.count += bitboards::count(targets);
+}
 
-      {
-        const int fx = x + offset2;
-        const int fy = y + offset1;
-        if (is_within_board(fx, fy)) {
-          simple_movement_to(board, Position(x, y), Position(fx, fy), field, moves);
-        }
-      }
-    }
+/// Adds pawn moves to every field in `targets`. Pawn making the move stands `offset` fields before
+/// its destination. Moves to the last rank are added once for every promotion piece.
+template <Color Us>
+static void add_pawn_moves(Bitboard targets, int offset, Move::Flags flags, MoveList& moves) {
+  auto promotions = targets & Side<Us>::promotion_rank;
+  targets &= ~Side<Us>::promotion_rank;
+
+  while (targets) {
+    const int to = bitboards::pop_square(targets);
+    moves.push_back(Move(Position::from_index(to - offset), Position::from_index(to), flags));
   }
-}
 
-static void king_moves(const Board& board, int x, int y, Field field, std::vector<Move>& moves) {
-  for (int oy = -1; oy <= 1; ++oy) {
-    for (int ox = -1; ox <= 1; ++ox) {
-      if (ox == 0 && oy == 0) {
-        continue;
-      }
+  const bool captures = flags == Move::Flags::Capture;
 
-      const int fx = x + ox;
-      const int fy = y + oy;
-      if (is_within_board(fx, fy)) {
-        simple_movement_to(board, Position(x, y), Position(fx, fy), field, moves);
-      }
+  while (promotions) {
+    const int to = bitboards::pop_square(promotions);
+    const auto from = Position::from_index(to - offset);
+
+    for (const auto piece : {Piece::Queen, Piece::Rook, Piece::Bishop, Piece::Knight}) {
+      moves.push_back(Move(from, Position::from_index(to), Move::promotion_flags(piece, captures)));
     }
   }
 }
 
-static void pawn_moves(const Board& board, int x, int y, Field field, std::vector<Move>& moves) {
-  const auto from = Position(x, y);
+template <Color Us>
+static void add_pawn_moves(Bitboard targets, int, Move::Flags, MoveCounter& counter) {
+  const auto promotions = targets & Side<Us>::promotion_rank;
+  counter.count += bitboards::count(targets & ~promotions) + bitboards::count(promotions) * 4;
+}
 
-  const int move_direction = pawn_move_direction(field.color);
-  const int max_movement = field.moved ? 1 : 2;
+/// Adds moves of `pawns` which capture pieces in `capturable` or end up on a field in `allowed`.
+/// Promotions belong to `MoveKind::Captures`, even if they don't capture anything.
+template <Color Us, typename Moves>
+static void pawn_moves(const Board& board, Bitboard pawns, Bitboard capturable, Bitboard allowed,
+                       MoveKind kind, Moves& moves) {
+  using S = Side<Us>;
+  constexpr int direction = S::pawn_direction * 8;
+
+  const auto empty = ~board.get_occupied();
+
+  auto push_targets = allowed;
+  if (kind == MoveKind::Captures) {
+    push_targets &= S::promotion_rank;
+  } else if (kind == MoveKind::Quiets) {
+    push_targets &= ~S::promotion_rank;
+  }
 
-  for (int i = 1; i <= max_movement; ++i) {
-    const int dy = y + i * move_direction;
-    if (dy < 0 || dy >= 8) {
-      break;
-    }
+  const auto single_pushes = S::pawn_push(pawns) & empty;
+  add_pawn_moves<Us>(single_pushes & push_targets, direction, Move::Flags::Quiet, moves);
 
-    const auto target_field = board.get_field(x, dy);
-    if (target_field.is_solid_piece()) {
-      break;
-    }
+  if (kind != MoveKind::Captures) {
+    const auto double_pushes = S::pawn_push(single_pushes & S::double_push_rank) & empty;
+    add_pawn_moves<Us>(double_pushes & allowed, direction * 2, Move::Flags::DoublePawnPush, moves);
+  }
 
-    const auto promotion = dy == 0 || dy == 7;
-    moves.push_back(Move{
-      .from = from,
-      .to = Position(x, dy),
-      .promotes = promotion,
-    });
+  if (kind == MoveKind::Quiets) {
+    return;
   }
 
-  const auto diagonal_capture = [&](int x_offset) {
-    const int dx = x + x_offset;
-    const int dy = y + move_direction;
-    if (!is_within_board(dx, dy)) {
-      return;
-    }
+  const auto pushed = S::pawn_push(pawns);
+  const auto targets = capturable & allowed;
+
+  add_pawn_moves<Us>(bitboards::west(pushed) & targets, direction - 1, Move::Flags::Capture, moves);
+  add_pawn_moves<Us>(bitboards::east(pushed) & targets, direction + 1, Move::Flags::Capture, moves);
+}
+
+/// Checks if the king of `Us` standing on `king_square` can move to `to` without being attacked.
+template <Color Us> static bool is_safe_king_target(const Board& board, int king_square, int to) {
+  // King is removed from the occupancy so it doesn't block sliders attacking it along the line it
+  // retreats on.
+  const auto occupied = board.get_occupied() ^ bitboards::from_square(king_square);
+  return !attackers_to<Side<Us>::them>(board, to, occupied);
+}
 
-    const auto target_field = board.get_field(dx, dy);
+/// Fields next to the king of `Us` which are in `targets` and aren't attacked by the opponent.
+template <Color Us>
+static Bitboard safe_king_targets(const Board& board, int king_square, Bitboard targets) {
+  Bitboard safe_targets = 0;
 
-    // Allow en passant capture.
-    if (target_field.piece == Piece::None || target_field.color == field.color) {
-      return;
+  auto candidates = attacks::king(king_square) & targets;
+  while (candidates) {
+    const int to = bitboards::pop_square(candidates);
+    if (is_safe_king_target<Us>(board, king_square, to)) {
+      safe_targets |= bitboards::from_square(to);
     }
+  }
 
-    const auto promotion = dy == 0 || dy == 7;
-    moves.push_back(Move{
-      .from = from,
-      .to = Position(dx, dy),
-      .captures = true,
-      .promotes = promotion,
-    });
-  };
+  return safe_targets;
+}
 
-  diagonal_capture(-1);
-  diagonal_capture(1);
+/// Fields on which pieces other than the king can end a move when `checkers` (at most one piece)
+/// attack the king: capturing the checking piece or blocking its ray. All fields if the king isn't
+/// in check.
+static Bitboard check_mask(int king_square, Bitboard checkers) {
+  if (!checkers) {
+    return ~Bitboard(0);
+  }
+
+  return attacks::between(king_square, bitboards::lowest_square(checkers)) | checkers;
 }
 
-static void calculate_moves_for_field(const Board& board, int x, int y, Field field,
-                                      std::vector<Move>& moves) {
-  switch (field.piece) {
-  case Piece::Pawn:
-    pawn_moves(board, x, y, field, moves);
-    break;
+/// Field of the pawn captured by an en passant capture from `from` to `to`. It stands next to the
+/// capturing pawn.
+static int en_passant_captured_square(int from, int to) { return from - from % 8 + to % 8; }
 
-  case Piece::Bishop:
-    diagonal_moves(board, x, y, field, moves);
-    break;
+/// Occupancy after an en passant capture from `from` to `to`: both pawns leave their fields.
+static Bitboard en_passant_occupancy(const Board& board, int from, int to) {
+  const auto captured = bitboards::from_square(en_passant_captured_square(from, to));
+  return (board.get_occupied() ^ bitboards::from_square(from) ^ captured) |
+         bitboards::from_square(to);
+}
 
-  case Piece::Knight:
-    knight_moves(board, x, y, field, moves);
-    break;
+/// Checks if en passant capture of `Us` from `from` to `to` leaves its king attacked. The capture
+/// removes two pieces from the same rank, which can expose the king in ways that pin detection
+/// doesn't catch. These moves are rare, so the resulting occupancy is checked directly.
+template <Color Us>
+static bool en_passant_exposes_king(const Board& board, int king_square, int from, int to) {
+  const auto captured = bitboards::from_square(en_passant_captured_square(from, to));
+  const auto occupied = en_passant_occupancy(board, from, to);
 
-  case Piece::Rook:
-    straight_moves(board, x, y, field, moves);
-    break;
+  return attackers_to<Side<Us>::them>(board, king_square, occupied) & ~captured;
+}
 
-  case Piece::Queen:
-    straight_moves(board, x, y, field, moves);
-    diagonal_moves(board, x, y, field, moves);
-    break;
+/// Adds en passant captures by `pawns` which don't leave the king of `Us` attacked.
+template <Color Us, typename Moves>
+static void en_passant_moves(const Board& board, int king_square, Bitboard pawns, Moves& moves) {
+  const auto target = en_passant_targets<Us>(board);
+  if (!target) {
+    return;
+  }
 
-  case Piece::King:
-    king_moves(board, x, y, field, moves);
-    break;
+  const int target_square = bitboards::lowest_square(target);
 
-  default:
-    break;
+  auto capturers = attacks::pawn(Side<Us>::them, target_square) & pawns;
+  while (capturers) {
+    const int from = bitboards::pop_square(capturers);
+
+    if (!en_passant_exposes_king<Us>(board, king_square, from, target_square)) {
+      moves.push_back(Move(Position::from_index(from), Position::from_index(target_square),
+                           Move::Flags::EnPassant));
+    }
   }
 }
 
@@ -243,363 +313,1249 @@ Board::Board() {
   for (int x = 0; x < 8; ++x) {
     set_piece(x, 1, Piece::Pawn);
   }
+
+  hash ^= zobrist::castling(castling_rights(*this));
+}
+
+template <Color Us> static CheckInfo check_info(const Board& board) {
+  constexpr auto opponent = Side<Us>::them;
+
+  CheckInfo info;
+  info.player_turn = Us;
+
+  const auto king = board.get_king_position(opponent);
+  if (!king) {
+    return info;
+  }
+
+  const int king_square = king->index();
+  const auto occupied = board.get_occupied();
+
+  info.king_square = king_square;
+  info.discovered_candidates = slider_blockers<Us>(board, king_square) & board.get_pieces(Us);
+
+  auto& fields = info.check_fields;
+  fields[size_t(Piece::Pawn)] = attacks::pawn(opponent, king_square);
+  fields[size_t(Piece::Knight)] = attacks::knight(king_square);
+  fields[size_t(Piece::Bishop)] = attacks::bishop(king_square, occupied);
+  fields[size_t(Piece::Rook)] = attacks::rook(king_square, occupied);
+  fields[size_t(Piece::Queen)] = fields[size_t(Piece::Bishop)] | fields[size_t(Piece::Rook)];
+
+  return info;
+}
+
+CheckInfo Board::get_check_info(Color player_turn) const {
+  if (player_turn == Color::White) {
+    return check_info<Color::White>(*this);
+  }
+
+  return check_info<Color::Black>(*this);
 }
 
-void Board::make_move(const Move& move, Piece promotion) {
-  const auto from_field = get_field(move.from);
-  const auto to_field = get_field(move.to);
+bool Board::gives_check(Move move, const CheckInfo& info) const {
+  if (info.king_square < 0) {
+    return false;
+  }
+
+  const int from = move.from().index();
+  const int to = move.to().index();
+  const int king_square = info.king_square;
+
+  // Direct check by the moved piece.
+  if (bitboards::contains(info.check_fields[size_t(get_field(move.from()).piece)], to)) {
+    return true;
+  }
+
+  // Discovered check by a slider behind the moved piece.
+  if (bitboards::contains(info.discovered_candidates, from) &&
+      !bitboards::contains(attacks::line(from, king_square), to)) {
+    return true;
+  }
+
+  const auto occupied = get_occupied() ^ bitboards::from_square(from);
+
+  if (move.promotes()) {
+    // The promoted piece attacks through the field which the pawn left.
+    return bitboards::contains(attacks::piece(move.promotion(), to, occupied), king_square);
+  }
+
+  if (move.is_en_passant()) {
+    // Removing the captured pawn can discover a check as well.
+    const auto after_capture = en_passant_occupancy(*this, from, to);
+
+    const auto queens = get_pieces(info.player_turn, Piece::Queen);
+    return (attacks::bishop(king_square, after_capture) &
+            (get_pieces(info.player_turn, Piece::Bishop) | queens)) ||
+           (attacks::rook(king_square, after_capture) &
+            (get_pieces(info.player_turn, Piece::Rook) | queens));
+  }
+
+  if (move.castles()) {
+    // Only the rook can give check, from the field which the king skipped.
+    const int direction = (move.to().x - move.from().x) / 2;
+    const auto rook_from = Position(direction == -1 ? 0 : 7, move.from().y).index();
+    const int rook_to = from + direction;
 
-  if (from_field.piece == Piece::Pawn || move.captures) {
+    const auto after_castling =
+      (occupied ^ bitboards::from_square(rook_from)) | bitboards::from_square(to);
+    return bitboards::contains(attacks::rook(rook_to, after_castling), king_square);
+  }
+
+  return false;
+}
+
+bool Board::gives_check(Move move) const {
+  return gives_check(move, get_check_info(get_field(move.from()).color));
+}
+
+MoveUndo Board::make_move(Move move) {
+  if (get_field(move.from()).color == Color::Black) {
+    return make_move<Color::Black>(move);
+  }
+
+  return make_move<Color::White>(move);
+}
+
+template <Color Us> MoveUndo Board::make_move(Move move) {
+  const auto from = move.from();
+  const auto to = move.to();
+
+  const auto from_field = get_field(from);
+  const auto to_field = get_field(to);
+
+  const MoveUndo undo{
+    .move = move,
+    .from_field = from_field,
+    .to_field = to_field,
+    .en_passant = en_passant,
+    .half_move_counter = uint16_t(half_move_counter),
+    .hash = hash,
+  };
+
+  // Castling rights can change only when an unmoved king or rook moves or gets captured.
+  const bool affects_castling =
+    (!from_field.moved && (from_field.piece == Piece::King || from_field.piece == Piece::Rook)) ||
+    (!to_field.moved && to_field.piece == Piece::Rook);
+  const int previous_castling_rights = affects_castling ? castling_rights(*this) : 0;
+
+  if (from_field.piece == Piece::Pawn || move.captures()) {
     half_move_counter = 0;
   } else {
     half_move_counter++;
   }
 
-  if (from_field.color == Color::Black) {
+  if constexpr (Us == Color::Black) {
     full_move_number++;
   }
 
   // Move piece from `from` to `to`. Promote it if needed.
-  set_field(move.from, Field{});
-  set_field(move.to, Field{from_field.color, move.promotes ? promotion : from_field.piece, true});
-
-  // Handle en passant capture.
-  if (move.captures && to_field.piece == Piece::PawnGhost) {
-    set_field(Position(move.to.x, move.to.y + pawn_move_direction(to_field.color)), Field{});
-    pawn_ghosts--;
-  }
-
-  // Pawn ghosts are valid for only one turn. Remove them.
-  if (pawn_ghosts > 0) {
-    for (int y = 0; y < 8; ++y) {
-      for (int x = 0; x < 8; ++x) {
-        if (get_field(x, y).piece == Piece::PawnGhost) {
-          set_field(x, y, Field{});
-        }
-      }
-    }
+  set_field(from, Field{});
+  const auto piece = move.promotes() ? move.promotion() : from_field.piece;
+  set_field(to, Field{Us, piece, true});
+
+  // Handle en passant capture. Captured pawn stands next to the capturing one.
+  if (move.is_en_passant()) {
+    set_field(Position(to.x, from.y), Field{});
+  }
 
-    pawn_ghosts = 0;
+  // En passant is valid for only one turn. Moving pawn by 2 places allows it for the next one.
+  if (en_passant) {
+    hash ^= zobrist::en_passant(en_passant->x);
+    en_passant = std::nullopt;
   }
 
-  // Moving pawn by 2 places leaves PawnGhost behind to handle en passant capture.
-  if (from_field.piece == Piece::Pawn) {
-    if (std::abs(int(move.from.y) - int(move.to.y)) == 2) {
-      set_field(Position(move.to.x, move.to.y - pawn_move_direction(from_field.color)),
-                Field{from_field.color, Piece::PawnGhost, true});
-      pawn_ghosts++;
+  if (move.is_double_pawn_push()) {
+    const auto skipped = Position(to.x, to.y - Side<Us>::pawn_direction);
+    const auto enemy_pawns = get_pieces(Side<Us>::them, Piece::Pawn);
+
+    if (attacks::pawn(Us, skipped.index()) & enemy_pawns) {
+      en_passant = skipped;
+      hash ^= zobrist::en_passant(skipped.x);
     }
   }
 
   // Handle castling.
-  if (move.castles) {
+  if (move.castles()) {
     // -1 = left
     // +1 = right
-    const int direction = (int(move.to.x) - int(move.from.x)) / 2;
+    const int direction = (int(to.x) - int(from.x)) / 2;
 
-    const auto rook_pos = Position(direction == -1 ? 0 : 7, move.from.y);
-    const auto rook_dest = Position(move.from.x + direction, move.from.y);
+    const auto rook_pos = Position(direction == -1 ? 0 : 7, from.y);
+    const auto rook_dest = Position(from.x + direction, from.y);
     const auto rook = get_field(rook_pos);
 
     // Move piece from `rook_pos` to `rook_dest`.
     set_field(rook_pos, Field{});
-    set_field(rook_dest, Field{rook.color, rook.piece, true});
+    set_field(rook_dest, Field{Us, rook.piece, true});
+  }
+
+  if (affects_castling) {
+    hash ^= zobrist::castling(previous_castling_rights) ^ zobrist::castling(castling_rights(*this));
   }
+
+  hash ^= zobrist::side();
+
+  return undo;
 }
 
-void Board::make_move(const PlayerMove& player_move) {
-  make_move(player_move.move, player_move.promotion);
+void Board::unmake_move(const MoveUndo& undo) {
+  const auto move = undo.move;
+  const auto from = move.from();
+  const auto to = move.to();
+  const auto color = undo.from_field.color;
+
+  half_move_counter = undo.half_move_counter;
+
+  if (color == Color::Black) {
+    full_move_number--;
+  }
+
+  // Move the rook back to its corner. Castling is allowed only if it has never moved.
+  if (move.castles()) {
+    const int direction = (int(to.x) - int(from.x)) / 2;
+
+    const auto rook_pos = Position(direction == -1 ? 0 : 7, from.y);
+    const auto rook_dest = Position(from.x + direction, from.y);
+
+    set_field(rook_dest, Field{});
+    set_field(rook_pos, Field{color, Piece::Rook, false});
+  }
+
+  en_passant = undo.en_passant;
+
+  // Restore pawn captured en passant.
+  if (move.is_en_passant()) {
+    set_field(Position(to.x, from.y), Field{other_color(color), Piece::Pawn, true});
+  }
+
+  set_field(to, undo.to_field);
+  set_field(from, undo.from_field);
+
+  // Pieces are already rehashed by `set_field`, but castling, en passant and side to move aren't.
+  hash = undo.hash;
 }
 
-std::vector<Move> Board::calculate_moves_without_castling(Color player_turn) const {
-  std::vector<Move> moves;
+template <Color Us> void Board::calculate_moves_without_castling(MoveList& moves) const {
+  const auto own = get_pieces(Us);
+  const auto enemies = get_pieces(Side<Us>::them);
+  const auto occupied = own | enemies;
+  const auto pawns = get_pieces(Us, Piece::Pawn);
 
-  for (int y = 0; y < 8; ++y) {
-    for (int x = 0; x < 8; ++x) {
-      const auto field = get_field(x, y);
-      if (!field.is_solid_piece() || field.color != player_turn) {
-        continue;
-      }
+  pawn_moves<Us>(*this, pawns, enemies, ~Bitboard(0), MoveKind::All, moves);
+
+  if (const auto target = en_passant_targets<Us>(*this)) {
+    const auto to = Position::from_index(bitboards::lowest_square(target));
 
-      calculate_moves_for_field(*this, x, y, field, moves);
+    auto capturers = attacks::pawn(Side<Us>::them, to.index()) & pawns;
+    while (capturers) {
+      moves.push_back(
+        Move(Position::from_index(bitboards::pop_square(capturers)), to, Move::Flags::EnPassant));
     }
   }
 
-  return moves;
-}
+  auto pieces = own & ~get_pieces(Piece::Pawn);
+  while (pieces) {
+    const int square = bitboards::pop_square(pieces);
+    const auto targets = attacks::piece(fields[square].piece, square, occupied) & ~own;
 
-std::vector<Move> Board::calculate_moves_with_castling(Color player_turn) const {
-  auto moves = calculate_moves_without_castling(player_turn);
+    add_moves(Position::from_index(square), targets, enemies, moves);
+  }
+}
 
-  const auto king_opt = find_piece(*this, player_turn, Piece::King);
+template <Color Us, typename Moves> void Board::add_castling_moves(Moves& moves) const {
+  const auto king_opt = get_king_position(Us);
   if (!king_opt) {
-    return moves;
+    return;
   }
 
   const auto king_pos = *king_opt;
   const auto king_field = get_field(king_pos);
   if (king_field.moved) {
-    return moves;
+    return;
   }
 
-  bool castling_left_blocked = false;
-  bool castling_right_blocked = false;
+  const auto occupied = get_occupied();
+  const auto is_attacked = [&](Position position) {
+    return attackers_to<Side<Us>::them>(*this, position.index(), occupied) != 0;
+  };
 
-  for (const auto move : calculate_moves_without_castling(other_color(player_turn))) {
-    const auto to = move.to;
+  // We cannot castle if the king is being attacked.
+  if (is_attacked(king_pos)) {
+    return;
+  }
 
-    // We cannot castle if the king is being attacked.
-    if (to == king_pos) {
-      return moves;
-    }
+  const auto is_valid_rook = [&](Position rook_pos) {
+    const auto field = get_field(rook_pos);
+    return !field.moved && field.piece == Piece::Rook && field.color == Us;
+  };
 
-    // Castling left would make king move through the attacked field.
-    if (to == Position(king_pos.x - 1, king_pos.y) || to == Position(king_pos.x - 2, king_pos.y)) {
-      castling_left_blocked = true;
-    }
+  const auto is_path_clear = [&](Position rook_pos) {
+    return (attacks::between(king_pos.index(), rook_pos.index()) & occupied) == 0;
+  };
+
+  // Castling would make king move through (or to) the attacked field.
+  const auto is_path_attacked = [&](int direction) {
+    return is_attacked(Position(king_pos.x + direction, king_pos.y)) ||
+           is_attacked(Position(king_pos.x + direction * 2, king_pos.y));
+  };
+
+  // -1 = left
+  // +1 = right
+  for (const int direction : {-1, 1}) {
+    const auto rook_pos = Position(direction == -1 ? 0 : 7, king_pos.y);
 
-    // Castling right would make king move through the attacked field.
-    if (to == Position(king_pos.x + 1, king_pos.y) || to == Position(king_pos.x + 2, king_pos.y)) {
-      castling_right_blocked = true;
+    if (is_valid_rook(rook_pos) && is_path_clear(rook_pos) && !is_path_attacked(direction)) {
+      moves.push_back(
+        Move(king_pos, Position(king_pos.x + direction * 2, king_pos.y), Move::Flags::Castles));
     }
   }
+}
 
-  if (castling_left_blocked && castling_right_blocked) {
-    return moves;
+void Board::calculate_moves_with_castling(Color player_turn, MoveList& moves) const {
+  if (player_turn == Color::White) {
+    calculate_moves_without_castling<Color::White>(moves);
+    add_castling_moves<Color::White>(moves);
+  } else {
+    calculate_moves_without_castling<Color::Black>(moves);
+    add_castling_moves<Color::Black>(moves);
   }
+}
 
-  const auto left_rook = get_field(Position(0, king_pos.y));
-  const auto right_rook = get_field(Position(7, king_pos.y));
+template <Color Us, typename Moves>
+void Board::add_evasions(int king_square, Bitboard checkers, Moves& moves) const {
+  const auto own = get_pieces(Us);
+  const auto enemies = get_pieces(Side<Us>::them);
+  const auto occupied = own | enemies;
+  const auto pawns = get_pieces(Us, Piece::Pawn);
+  const auto king = bitboards::from_square(king_square);
 
-  const auto is_valid_rook = [&](Field field) {
-    return !field.moved && field.piece == Piece::Rook && field.color == player_turn;
-  };
+  add_moves(Position::from_index(king_square),
+            safe_king_targets<Us>(*this, king_square, ~own), enemies, moves);
+
+  // Only the king can escape from double check.
+  if (bitboards::count(checkers) > 1) {
+    return;
+  }
+
+  // Other pieces have to capture the checking piece or block its ray. Pinned pieces can do neither
+  // because they can only move along the line between the king and the pinning piece.
+  const auto evasion_mask = check_mask(king_square, checkers);
+  const auto movable = ~pinned_pieces<Us>(*this, king_square);
 
-  // [from, to)
-  const auto is_path_clear = [&](int from, int to) {
-    for (int x = from; x < to; ++x) {
-      if (get_field(x, king_pos.y).is_solid_piece()) {
-        return false;
+  pawn_moves<Us>(*this, pawns & movable, enemies, evasion_mask, MoveKind::All, moves);
+
+  auto pieces = own & ~pawns & ~king & movable;
+  while (pieces) {
+    const int square = bitboards::pop_square(pieces);
+    const auto targets = attacks::piece(fields[square].piece, square, occupied) & evasion_mask;
+
+    add_moves(Position::from_index(square), targets, enemies, moves);
+  }
+
+  en_passant_moves<Us>(*this, king_square, pawns, moves);
+}
+
+void Board::calculate_legal_moves(Color player_turn, MoveKind kind, MoveList& moves) const {
+  if (player_turn == Color::White) {
+    calculate_legal_moves<Color::White>(kind, moves);
+  } else {
+    calculate_legal_moves<Color::Black>(kind, moves);
+  }
+}
+
+template <Color Us, typename Moves>
+void Board::calculate_legal_moves(MoveKind kind, Moves& moves) const {
+  const int king_square = king_squares[size_t(Us)];
+  if (king_square < 0) {
+    // Unreachable for boards from `from_fen` or `Board()`, which always have both kings. Without
+    // a king every pseudo-legal move is legal, and their number isn't bounded by `MoveList`
+    // capacity.
+    MoveList pseudo_legal_moves;
+    calculate_moves_with_castling(Us, pseudo_legal_moves);
+
+    for (const auto move : pseudo_legal_moves) {
+      if (kind == MoveKind::All || move.kind() == kind) {
+        moves.push_back(move);
       }
     }
 
+    return;
+  }
+
+  constexpr auto opponent = Side<Us>::them;
+  const auto king = bitboards::from_square(king_square);
+
+  const auto own = get_pieces(Us);
+  const auto enemies = get_pieces(opponent);
+  const auto occupied = own | enemies;
+  const auto pawns = get_pieces(Us, Piece::Pawn);
+
+  const auto checkers = attackers_to<opponent>(*this, king_square, occupied);
+  if (checkers && kind == MoveKind::All) {
+    add_evasions<Us>(king_square, checkers, moves);
+    return;
+  }
+
+  // Fields on which moves of the requested kind can end. Pawns are filtered by `pawn_moves`.
+  const auto kind_targets = (kind != MoveKind::Quiets ? enemies : 0) |
+                            (kind != MoveKind::Captures ? ~occupied : 0);
+
+  add_moves(Position::from_index(king_square),
+            safe_king_targets<Us>(*this, king_square, kind_targets), enemies, moves);
+
+  // Only the king can escape from double check.
+  if (bitboards::count(checkers) > 1) {
+    return;
+  }
+
+  // Under check other pieces have to capture the checking piece or block its ray.
+  const auto evasion_mask = check_mask(king_square, checkers);
+
+  // Pinned pieces can only move along the line between the king and the pinning piece.
+  const auto pinned = pinned_pieces<Us>(*this, king_square);
+
+  pawn_moves<Us>(*this, pawns & ~pinned, enemies, evasion_mask, kind, moves);
+
+  auto pinned_pawns = pawns & pinned;
+  while (pinned_pawns) {
+    const int square = bitboards::pop_square(pinned_pawns);
+    pawn_moves<Us>(*this, bitboards::from_square(square), enemies,
+                   evasion_mask & attacks::line(king_square, square), kind, moves);
+  }
+
+  const auto allowed = kind_targets & evasion_mask;
+
+  auto pieces = own & ~pawns & ~king;
+  while (pieces) {
+    const int square = bitboards::pop_square(pieces);
+
+    auto targets = attacks::piece(fields[square].piece, square, occupied) & allowed;
+    if (bitboards::contains(pinned, square)) {
+      targets &= attacks::line(king_square, square);
+    }
+
+    add_moves(Position::from_index(square), targets, enemies, moves);
+  }
+
+  if (kind != MoveKind::Quiets) {
+    en_passant_moves<Us>(*this, king_square, pawns, moves);
+  }
+
+  if (!checkers && kind != MoveKind::Captures) {
+    add_castling_moves<Us>(moves);
+  }
+}
+
+void Board::calculate_legal_moves(Color player_turn, MoveList& moves) const {
+  calculate_legal_moves(player_turn, MoveKind::All, moves);
+}
+
+void Board::calculate_captures(Color player_turn, MoveList& moves) const {
+  calculate_legal_moves(player_turn, MoveKind::Captures, moves);
+}
+
+void Board::calculate_quiet_moves(Color player_turn, MoveList& moves) const {
+  calculate_legal_moves(player_turn, MoveKind::Quiets, moves);
+}
+
+void Board::calculate_evasions(Color player_turn, MoveList& moves) const {
+  const int king_square = king_squares[size_t(player_turn)];
+  if (king_square < 0 || !is_square_attacked(Position::from_index(king_square),
+                                             other_color(player_turn))) {
+    return;
+  }
+
+  const auto occupied = get_occupied();
+
+  if (player_turn == Color::White) {
+    add_evasions<Color::White>(
+      king_square, attackers_to<Color::Black>(*this, king_square, occupied), moves);
+  } else {
+    add_evasions<Color::Black>(
+      king_square, attackers_to<Color::White>(*this, king_square, occupied), moves);
+  }
+}
+
+template <Color Us> bool Board::has_legal_move() const {
+  const int king_square = king_squares[size_t(Us)];
+  if (king_square < 0) {
+    return count_legal_moves(Us) != 0;
+  }
+
+  const auto own = get_pieces(Us);
+  const auto occupied = get_occupied();
+  const auto pawns = get_pieces(Us, Piece::Pawn);
+  const auto king = bitboards::from_square(king_square);
+
+  // Castling is never the only legal move: the field the king passes through is empty and not
+  // attacked, so the king can move there instead.
+  if (safe_king_targets<Us>(*this, king_square, ~own)) {
     return true;
-  };
+  }
 
-  const auto add_castling_move = [&](int offset) {
-    moves.push_back(Move{
-      .from = king_pos,
-      .to = Position(king_pos.x + offset, king_pos.y),
-      .castles = true,
-    });
-  };
+  const auto checkers = attackers_to<Side<Us>::them>(*this, king_square, occupied);
+  if (bitboards::count(checkers) > 1) {
+    return false;
+  }
+
+  const auto evasion_mask = check_mask(king_square, checkers);
+  const auto pinned = pinned_pieces<Us>(*this, king_square);
+
+  auto pieces = own & ~pawns & ~king;
+  while (pieces) {
+    const int square = bitboards::pop_square(pieces);
+
+    auto targets = attacks::piece(fields[square].piece, square, occupied) & ~own & evasion_mask;
+    if (bitboards::contains(pinned, square)) {
+      targets &= attacks::line(king_square, square);
+    }
 
-  if (!castling_left_blocked && is_valid_rook(left_rook) && is_path_clear(1, king_pos.x)) {
-    add_castling_move(-2);
+    if (targets) {
+      return true;
+    }
+  }
+
+  const auto enemies = get_pieces(Side<Us>::them);
+
+  MoveCounter counter;
+  pawn_moves<Us>(*this, pawns & ~pinned, enemies, evasion_mask, MoveKind::All, counter);
+
+  auto pinned_pawns = pawns & pinned;
+  while (pinned_pawns && !counter.count) {
+    const int square = bitboards::pop_square(pinned_pawns);
+    pawn_moves<Us>(*this, bitboards::from_square(square), enemies,
+                   evasion_mask & attacks::line(king_square, square), MoveKind::All, counter);
+  }
+
+  if (!counter.count) {
+    en_passant_moves<Us>(*this, king_square, pawns, counter);
   }
 
-  if (!castling_right_blocked && is_valid_rook(right_rook) && is_path_clear(king_pos.x + 1, 7)) {
-    add_castling_move(2);
+  return counter.count != 0;
+}
+
+size_t Board::count_legal_moves(Color player_turn) const {
+  MoveCounter counter;
+
+  if (player_turn == Color::White) {
+    calculate_legal_moves<Color::White>(MoveKind::All, counter);
+  } else {
+    calculate_legal_moves<Color::Black>(MoveKind::All, counter);
+  }
+
+  return counter.count;
+}
+
+bool Board::has_legal_move(Color player_turn) const {
+  if (player_turn == Color::White) {
+    return has_legal_move<Color::White>();
   }
 
-  return moves;
+  return has_legal_move<Color::Black>();
 }
 
 std::vector<Move> Board::calculate_legal_moves(Color player_turn) const {
-  auto moves = calculate_moves_with_castling(player_turn);
+  MoveList moves;
+  calculate_legal_moves(player_turn, moves);
+
+  return moves.to_vector();
+}
+
+template <Color Us> bool Board::is_pseudo_legal(Move move) const {
+  using S = Side<Us>;
+
+  const auto from = move.from();
+  const auto to = move.to();
+  const auto field = get_field(from);
+  const auto target = get_field(to);
+
+  if (field.color != Us || from == to) {
+    return false;
+  }
+
+  // Kings are never captured.
+  if (target.is_solid_piece() && (target.color == Us || target.piece == Piece::King)) {
+    return false;
+  }
+
+  if (move.castles()) {
+    if (field.piece != Piece::King) {
+      return false;
+    }
+
+    // Castling has many conditions and is rare, so it's checked against generated moves.
+    MoveList moves;
+    add_castling_moves<Us>(moves);
+
+    return std::find(moves.begin(), moves.end(), move) != moves.end();
+  }
+
+  if (move.is_en_passant()) {
+    // Only the side which didn't make the double push can capture, like in the generators.
+    return field.piece == Piece::Pawn &&
+           bitboards::contains(en_passant_targets<Us>(*this), to.index()) &&
+           bitboards::contains(attacks::pawn(Us, from.index()), to.index());
+  }
+
+  if (move.captures() != target.is_solid_piece()) {
+    return false;
+  }
+
+  const auto occupied = get_occupied();
+
+  if (field.piece != Piece::Pawn) {
+    return (move.flags() == Move::Flags::Quiet || move.flags() == Move::Flags::Capture) &&
+           bitboards::contains(attacks::piece(field.piece, from.index(), occupied), to.index());
+  }
+
+  // Pawns must promote on the last rank and only there.
+  if (move.promotes() != bitboards::contains(S::promotion_rank, to.index())) {
+    return false;
+  }
 
-  std::erase_if(moves, [&](const Move& move) {
-    // Simulate this move.
-    auto after_move = *this;
-    after_move.make_move(move, Piece::Queen);
+  if (move.captures()) {
+    return (move.flags() == Move::Flags::Capture || move.promotes()) &&
+           bitboards::contains(attacks::pawn(Us, from.index()), to.index());
+  }
+
+  const auto single_push = S::pawn_push(bitboards::from_square(from.index())) & ~occupied;
 
-    // Disallow moves which would expose this player's king.
-    return after_move.is_king_under_attack(player_turn);
-  });
+  if (move.is_double_pawn_push()) {
+    const auto double_push = S::pawn_push(single_push & S::double_push_rank) & ~occupied;
+    return bitboards::contains(double_push, to.index());
+  }
 
-  return moves;
+  return (move.flags() == Move::Flags::Quiet || move.promotes()) &&
+         bitboards::contains(single_push, to.index());
 }
 
-bool Board::is_king_under_attack(Color player_turn) const {
-  // Castling won't affect the king anyway so just skip it.
-  for (const auto& move : calculate_moves_without_castling(other_color(player_turn))) {
-    const auto field = get_field(move.to);
-    if (field.piece == chess::Piece::King && field.color == player_turn) {
-      return true;
+bool Board::is_pseudo_legal(Color player_turn, Move move) const {
+  if (player_turn == Color::White) {
+    return is_pseudo_legal<Color::White>(move);
+  }
+
+  return is_pseudo_legal<Color::Black>(move);
+}
+
+template <Color Us> bool Board::is_legal(Move move) const {
+  constexpr auto opponent = Side<Us>::them;
+
+  if (!is_pseudo_legal<Us>(move)) {
+    return false;
+  }
+
+  // Castling moves are generated only when they are legal.
+  if (move.castles()) {
+    return true;
+  }
+
+  const int from = move.from().index();
+  const int to = move.to().index();
+  const auto occupied = get_occupied();
+
+  if (get_field(move.from()).piece == Piece::King) {
+    return is_safe_king_target<Us>(*this, from, to);
+  }
+
+  const int king_square = king_squares[size_t(Us)];
+  if (king_square < 0) {
+    return true;
+  }
+
+  if (move.is_en_passant()) {
+    return !en_passant_exposes_king<Us>(*this, king_square, from, to);
+  }
+
+  const auto checkers = attackers_to<opponent>(*this, king_square, occupied);
+
+  if (checkers) {
+    // Only the king can escape a double check. A single check must be captured or blocked.
+    if (bitboards::count(checkers) > 1) {
+      return false;
+    }
+
+    if (!bitboards::contains(check_mask(king_square, checkers), to)) {
+      return false;
     }
   }
 
-  return false;
+  // Pinned pieces can only move along the pin.
+  return !bitboards::contains(pinned_pieces<Us>(*this, king_square), from) ||
+         bitboards::contains(attacks::line(from, king_square), to);
+}
+
+bool Board::is_legal(Color player_turn, Move move) const {
+  if (player_turn == Color::White) {
+    return is_legal<Color::White>(move);
+  }
+
+  return is_legal<Color::Black>(move);
+}
+
+bool Board::is_king_under_attack(Color player_turn) const {
+  const int king_square = king_squares[size_t(player_turn)];
+  if (king_square < 0) {
+    return false;
+  }
+
+  return is_square_attacked(Position::from_index(king_square), other_color(player_turn));
+}
+
+bool Board::is_square_attacked(Position position, Color by) const {
+  const auto occupied = get_occupied();
+
+  if (by == Color::White) {
+    return attackers_to<Color::White>(*this, position.index(), occupied) != 0;
+  }
+
+  return attackers_to<Color::Black>(*this, position.index(), occupied) != 0;
 }
 
 bool Board::is_material_insufficient() const {
-  using Pieces = std::vector<std::pair<Piece, bool>>;
+  constexpr auto key = [](Color color, Piece piece, bool dark_square = false) {
+    return material::piece_key(color, piece, dark_square);
+  };
 
-  Pieces p1, p2;
-  {
-    Pieces pieces[2];
+  // Kings alone, king against king and a minor piece, and kings with one bishop each when both
+  // bishops stand on fields of the same color.
+  constexpr uint64_t insufficient_keys[] = {
+    0,
+    key(Color::White, Piece::Knight),
+    key(Color::Black, Piece::Knight),
+    key(Color::White, Piece::Bishop, false),
+    key(Color::White, Piece::Bishop, true),
+    key(Color::Black, Piece::Bishop, false),
+    key(Color::Black, Piece::Bishop, true),
+    key(Color::White, Piece::Bishop, false) + key(Color::Black, Piece::Bishop, false),
+    key(Color::White, Piece::Bishop, true) + key(Color::Black, Piece::Bishop, true),
+  };
 
-    // Collect pieces of every color.
-    for (int y = 0; y < 8; ++y) {
-      for (int x = 0; x < 8; ++x) {
-        const auto field = get_field(x, y);
-        if (!field.is_solid_piece()) {
-          continue;
-        }
+  return std::find(std::begin(insufficient_keys), std::end(insufficient_keys), material_key) !=
+         std::end(insufficient_keys);
+}
 
-        pieces[field.color == Color::White ? 0 : 1].push_back({field.piece, (x + y) % 2 == 0});
-      }
-    }
+/// Pieces of both colors attacking `square`, with sliders blocked by `occupied`.
+static Bitboard all_attackers_to(const Board& board, int square, Bitboard occupied) {
+  return attackers_to<Color::White>(board, square, occupied) |
+         attackers_to<Color::Black>(board, square, occupied);
+}
 
-    p1 = std::move(pieces[0]);
-    p2 = std::move(pieces[1]);
+/// Position on the destination of `move` right after it's made: what it captured, the value of the
+/// piece which now stands there and pieces which can capture it.
+struct Exchange {
+  int captured_value = 0;
+  int piece_value = 0;
+  Bitboard occupied = 0;
+  Bitboard attackers = 0;
+};
+
+static Exchange start_exchange(const Board& board, Move move) {
+  const auto from = move.from();
+  const auto to = move.to();
+
+  auto piece = board.get_field(from).piece;
+
+  Exchange exchange;
+  exchange.captured_value = material::piece_value(board.get_field(to).piece);
+  exchange.occupied = board.get_occupied() ^ bitboards::from_square(from.index());
+
+  if (move.is_en_passant()) {
+    exchange.captured_value = material::piece_value(Piece::Pawn);
+    exchange.occupied ^= bitboards::from_square(Position(to.x, from.y).index());
   }
 
-  if (p1.size() > p2.size()) {
-    std::swap(p1, p2);
+  if (move.promotes()) {
+    piece = move.promotion();
+    exchange.captured_value += material::piece_value(piece) - material::piece_value(Piece::Pawn);
   }
 
-  // Assumption: king is always present.
+  exchange.piece_value = material::piece_value(piece);
+  exchange.attackers = all_attackers_to(board, to.index(), exchange.occupied) & exchange.occupied;
 
-  if (p1.size() == 1) {
-    // king against king
-    if (p2.size() == 1) {
-      return true;
+  return exchange;
+}
+
+/// Removes the least valuable piece of `side_attackers` from the exchange on `square` and adds
+/// sliders which were behind it. Returns the type of the removed piece.
+static Piece pop_least_valuable_attacker(const Board& board, int square, Bitboard side_attackers,
+                                         Exchange& exchange) {
+  const auto queens = board.get_pieces(Piece::Queen);
+  const auto diagonal_sliders = board.get_pieces(Piece::Bishop) | queens;
+  const auto straight_sliders = board.get_pieces(Piece::Rook) | queens;
+
+  for (const auto piece : {Piece::Pawn, Piece::Knight, Piece::Bishop, Piece::Rook, Piece::Queen,
+                           Piece::King}) {
+    const auto candidates = side_attackers & board.get_pieces(piece);
+    if (!candidates) {
+      continue;
     }
 
-    // king against king and bishop
-    // king against king and knight
-    if (p2.size() == 2) {
-      const auto a = p2[0].first;
-      const auto b = p2[1].first;
-      if (a == Piece::Bishop || b == Piece::Bishop || a == Piece::Knight || b == Piece::Knight) {
-        return true;
-      }
+    exchange.occupied ^= bitboards::from_square(bitboards::lowest_square(candidates));
+
+    // Only sliders moving the same way as the removed piece can be behind it.
+    if (piece == Piece::Pawn || piece == Piece::Bishop || piece == Piece::Queen) {
+      exchange.attackers |= attacks::bishop(square, exchange.occupied) & diagonal_sliders;
+    }
+
+    if (piece == Piece::Rook || piece == Piece::Queen) {
+      exchange.attackers |= attacks::rook(square, exchange.occupied) & straight_sliders;
     }
+
+    exchange.attackers &= exchange.occupied;
+
+    return piece;
   }
 
-  if (p1.size() == 2 && p2.size() == 2) {
-    // king and bishop against king and bishop, with both bishops on squares of the same color
-    const auto a = p1[0].first == Piece::King ? p1[1] : p1[0];
-    const auto b = p2[0].first == Piece::King ? p2[1] : p2[0];
-    if (a.first == Piece::Bishop && b.first == Piece::Bishop && a.second == b.second) {
-      return true;
+  return Piece::None;
+}
+
+int Board::see(Move move) const {
+  if (move.castles()) {
+    return 0;
+  }
+
+  const int to = move.to().index();
+
+  auto exchange = start_exchange(*this, move);
+  auto side = other_color(get_field(move.from()).color);
+
+  // Material won by the side which made the capture at every depth if the exchange stopped there.
+  // Every capture removes a piece, so there are fewer than 32 of them.
+  std::array<int, 32> gains{};
+  int depth = 0;
+
+  gains[0] = exchange.captured_value;
+
+  while (true) {
+    const auto side_attackers = exchange.attackers & get_pieces(side);
+    if (!side_attackers) {
+      break;
     }
+
+    depth++;
+    gains[depth] = exchange.piece_value - gains[depth - 1];
+
+    const auto piece = pop_least_valuable_attacker(*this, to, side_attackers, exchange);
+    exchange.piece_value = material::piece_value(piece);
+
+    side = other_color(side);
   }
 
-  return false;
+  // Every side captures only if it doesn't lose material by doing so.
+  for (; depth > 0; --depth) {
+    gains[depth - 1] = -std::max(-gains[depth - 1], gains[depth]);
+  }
+
+  return gains[0];
 }
 
-std::string Board::get_fen_string(Color player_turn) const {
-  std::string result;
+bool Board::see_ge(Move move, int threshold) const {
+  if (move.castles()) {
+    return threshold <= 0;
+  }
+
+  const int to = move.to().index();
+
+  auto exchange = start_exchange(*this, move);
+  auto side = other_color(get_field(move.from()).color);
+
+  // Material above the threshold if the exchange stopped now, from the perspective of the side
+  // which captures next. Checked against the threshold after every capture, so the exchange is
+  // followed only while the answer isn't known.
+  int balance = exchange.captured_value - threshold;
+  if (balance < 0) {
+    return false;
+  }
+
+  balance = exchange.piece_value - balance;
+  if (balance <= 0) {
+    return true;
+  }
+
+  bool result = true;
+
+  while (true) {
+    const auto side_attackers = exchange.attackers & get_pieces(side);
+    if (!side_attackers) {
+      break;
+    }
+
+    result = !result;
+
+    const auto piece = pop_least_valuable_attacker(*this, to, side_attackers, exchange);
+
+    // King can capture only if the opponent has nothing left to recapture with.
+    if (piece == Piece::King) {
+      return exchange.attackers & get_pieces(other_color(side)) ? !result : result;
+    }
+
+    balance = material::piece_value(piece) - balance;
+    if (balance < int(result)) {
+      break;
+    }
+
+    side = other_color(side);
+  }
+
+  return result;
+}
+
+std::optional<FenPosition> Board::from_fen(std::string_view fen, FenError* error) {
+  return parse_fen(fen, false, nullptr, error);
+}
+
+std::optional<FenPosition> Board::from_epd(std::string_view epd, std::string_view* operations,
+                                           FenError* error) {
+  return parse_fen(epd, true, operations, error);
+}
+
+std::optional<FenPosition> Board::parse_fen(std::string_view fen, bool epd,
+                                            std::string_view* operations, FenError* error) {
+  const auto text = fen;
 
-  const auto piece_to_char = [&](Color color, Piece piece) -> char {
-    char c = ' ';
+  const auto fail = [&](std::string_view at, const char* message) -> std::optional<FenPosition> {
+    if (error) {
+      error->offset = size_t(at.data() - text.data());
+      error->message = message;
+    }
+
+    return std::nullopt;
+  };
+
+  // Parts may be separated by any whitespace, so lines read with `\r\n` endings or tabs work.
+  constexpr std::string_view whitespace = " \t\n\v\f\r";
+
+  // Returns the next whitespace separated part of `fen` (empty if there are no more parts).
+  const auto next_part = [&]() -> std::string_view {
+    const auto start = std::min(fen.find_first_not_of(whitespace), fen.size());
+    const auto end = std::min(fen.find_first_of(whitespace, start), fen.size());
+
+    const auto part = fen.substr(start, end - start);
+    fen.remove_prefix(end);
+
+    return part;
+  };
+
+  const auto parse_number = [](std::string_view part, int& value) {
+    const auto end = part.data() + part.size();
+    const auto result = std::from_chars(part.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end;
+  };
+
+  FenPosition position{Board(Empty{}), Color::White};
+  auto& board = position.board;
+
+  // Pieces placement. Kings and rooks are marked as moved until castling rights say otherwise.
+  const auto placement = next_part();
+
+  int x = 0;
+  int y = 7;
+
+  for (size_t i = 0; i < placement.size(); ++i) {
+    const char c = placement[i];
+    const auto at = placement.substr(i);
+
+    if (c == '/') {
+      if (x != 8 || y == 0) {
+        return fail(at, "rank doesn't have 8 fields");
+      }
 
-    switch (piece) {
-    case Piece::Pawn:
-      c = 'p';
+      x = 0;
+      y--;
+      continue;
+    }
+
+    if (c >= '1' && c <= '8') {
+      x += c - '0';
+      if (x > 8) {
+        return fail(at, "rank doesn't have 8 fields");
+      }
+
+      continue;
+    }
+
+    Piece piece = Piece::None;
+
+    switch (std::tolower(uint8_t(c))) {
+    case 'p':
+      piece = Piece::Pawn;
       break;
-    case Piece::Bishop:
-      c = 'b';
+    case 'b':
+      piece = Piece::Bishop;
       break;
-    case Piece::Knight:
-      c = 'n';
+    case 'n':
+      piece = Piece::Knight;
       break;
-    case Piece::Rook:
-      c = 'r';
+    case 'r':
+      piece = Piece::Rook;
       break;
-    case Piece::Queen:
-      c = 'q';
+    case 'q':
+      piece = Piece::Queen;
       break;
-    case Piece::King:
-      c = 'k';
+    case 'k':
+      piece = Piece::King;
       break;
     default:
-      break;
+      return fail(at, "invalid piece");
     }
 
-    return color == Color::White ? char(std::toupper(c)) : c;
-  };
+    const auto color = std::isupper(uint8_t(c)) ? Color::White : Color::Black;
 
-  // Pieces placement.
-  for (int y = 7; y >= 0; --y) {
-    for (int x = 0; x < 8; ++x) {
-      const auto field = get_field(x, y);
-      if (field.is_solid_piece()) {
-        result += piece_to_char(field.color, field.piece);
-      } else {
-        int count = 1;
-
-        while (true) {
-          const int nx = x + 1;
-          if (nx >= 8 || get_field(nx, y).is_solid_piece()) {
-            break;
-          }
-
-          count++;
-          x++;
-        }
-
-        result += std::to_string(count);
-      }
+    if (x >= 8) {
+      return fail(at, "rank doesn't have 8 fields");
     }
 
-    if (y != 0) {
-      result += "/";
+    if (piece == Piece::Pawn && (y == 0 || y == 7)) {
+      return fail(at, "pawn on the first or the last rank");
+    }
+
+    if (piece == Piece::King && board.get_king_position(color)) {
+      return fail(at, "more than one king of the same color");
     }
+
+    const bool at_home = color == Color::White ? y == 1 : y == 6;
+    const bool moved =
+      piece == Piece::Pawn ? !at_home : piece == Piece::King || piece == Piece::Rook;
+
+    board.set_field(x, y, Field{color, piece, moved});
+    x++;
   }
 
-  // Player turn.
-  result += player_turn == Color::White ? " w " : " b ";
+  if (x != 8 || y != 0) {
+    return fail(placement.substr(placement.size()), "board doesn't have 8 ranks of 8 fields");
+  }
 
-  // Castling rights.
-  bool any_castling_rights = false;
+  // Generators, `MoveList` capacity and material key slots rely on a king and at most 16 pieces
+  // (8 of them pawns) of every color.
   for (const auto color : {Color::White, Color::Black}) {
-    const auto y = color == Color::White ? 0 : 7;
-    const auto king = get_field(4, y);
-    if (king.piece != Piece::King || king.moved) {
-      continue;
-    }
+    const auto end = placement.substr(placement.size());
 
-    const auto king_side = get_field(7, y);
-    const auto queen_side = get_field(0, y);
+    if (!board.get_king_position(color)) {
+      return fail(end, "missing king");
+    }
 
-    if (king_side.piece == Piece::Rook && !king_side.moved) {
-      result += piece_to_char(color, Piece::King);
-      any_castling_rights = true;
+    if (bitboards::count(board.get_pieces(color, Piece::Pawn)) > material::max_pawns) {
+      return fail(end, "more than 8 pawns of the same color");
     }
 
-    if (queen_side.piece == Piece::Rook && !queen_side.moved) {
-      result += piece_to_char(color, Piece::Queen);
-      any_castling_rights = true;
+    if (bitboards::count(board.get_pieces(color)) > material::max_pieces) {
+      return fail(end, "more than 16 pieces of the same color");
     }
   }
 
-  if (any_castling_rights) {
-    result += ' ';
+  // Player turn.
+  const auto turn = next_part();
+  if (turn == "w") {
+    position.player_turn = Color::White;
+  } else if (turn == "b") {
+    position.player_turn = Color::Black;
+    board.hash ^= zobrist::side();
   } else {
-    result += "- ";
+    return fail(turn, "side to move must be 'w' or 'b'");
+  }
+
+  const auto us = position.player_turn;
+  const auto them = other_color(us);
+
+  if (board.is_king_under_attack(them)) {
+    return fail(turn, "side which isn't on the move is in check");
+  }
+
+  // Castling rights.
+  const auto castling = next_part();
+  if (castling.empty()) {
+    return fail(castling, "missing castling rights");
   }
 
+  if (castling != "-") {
+    for (size_t i = 0; i < castling.size(); ++i) {
+      const char c = castling[i];
+      const auto lower = std::tolower(uint8_t(c));
+      if (lower != 'k' && lower != 'q') {
+        return fail(castling.substr(i), "invalid castling right");
+      }
+
+      const auto color = std::isupper(uint8_t(c)) ? Color::White : Color::Black;
+      const int rook_x = lower == 'k' ? 7 : 0;
+      const int home_y = color == Color::White ? 0 : 7;
+
+      const auto king = board.get_field(4, home_y);
+      const auto rook = board.get_field(rook_x, home_y);
+
+      if (king.piece != Piece::King || king.color != color || rook.piece != Piece::Rook ||
+          rook.color != color) {
+        return fail(castling.substr(i), "castling right without a king and a rook at home");
+      }
+
+      board.set_field(4, home_y, Field{color, Piece::King, false});
+      board.set_field(rook_x, home_y, Field{color, Piece::Rook, false});
+    }
+  }
+
+  board.hash ^= zobrist::castling(castling_rights(board));
+
   // En passant.
-  bool en_passant_available = false;
-  if (pawn_ghosts > 0) {
-    if (const auto ghost = find_piece(*this, other_color(player_turn), Piece::PawnGhost)) {
-      const char chars[] = "abcdefgh";
-      result += chars[ghost->x];
-      result += std::to_string(int(ghost->y) + 1);
-      en_passant_available = true;
+  const auto en_passant = next_part();
+  if (en_passant.empty()) {
+    return fail(en_passant, "missing en passant field");
+  }
+
+  if (en_passant != "-") {
+    // The field skipped by the enemy pawn and the field it stands on now.
+    const int skipped_y = us == Color::White ? 5 : 2;
+    const int pawn_y = us == Color::White ? 4 : 3;
+
+    if (en_passant.size() != 2 || en_passant[0] < 'a' || en_passant[0] > 'h' ||
+        en_passant[1] - '1' != skipped_y) {
+      return fail(en_passant, "invalid en passant field");
+    }
+
+    const auto skipped = Position(en_passant[0] - 'a', skipped_y);
+
+    const auto pawn = board.get_field(skipped.x, pawn_y);
+    if (pawn.piece != Piece::Pawn || pawn.color != them) {
+      return fail(en_passant, "no pawn which could have skipped the en passant field");
+    }
+
+    // The pawn passed through the skipped field from its starting field, so both are empty.
+    const int start_y = skipped_y * 2 - pawn_y;
+    if (board.get_field(skipped).is_solid_piece() ||
+        board.get_field(skipped.x, start_y).is_solid_piece()) {
+      return fail(en_passant, "en passant field or the field behind it isn't empty");
+    }
+
+    // Keep the field only if a pawn can capture on it, like `make_move` does.
+    if (attacks::pawn(them, skipped.index()) & board.get_pieces(us, Piece::Pawn)) {
+      board.en_passant = skipped;
+      board.hash ^= zobrist::en_passant(skipped.x);
+    }
+  }
+
+  if (epd) {
+    if (operations) {
+      const auto start = std::min(fen.find_first_not_of(whitespace), fen.size());
+      const auto end = fen.find_last_not_of(whitespace) + 1;
+
+      *operations = fen.substr(start, std::max(start, end) - start);
     }
+
+    return position;
+  }
+
+  // Halfmove and fullmove counters.
+  const auto half_move_counter = next_part();
+  if (!half_move_counter.empty() &&
+      (!parse_number(half_move_counter, board.half_move_counter) || board.half_move_counter < 0 ||
+       board.half_move_counter > max_fen_counter)) {
+    return fail(half_move_counter, "invalid halfmove counter");
   }
 
-  if (en_passant_available) {
-    result += ' ';
+  const auto full_move_number = next_part();
+  if (!full_move_number.empty() &&
+      (!parse_number(full_move_number, board.full_move_number) || board.full_move_number < 1 ||
+       board.full_move_number > max_fen_counter)) {
+    return fail(full_move_number, "invalid fullmove number");
+  }
+
+  const auto rest = next_part();
+  if (!rest.empty()) {
+    return fail(rest, "unexpected text after the fullmove number");
+  }
+
+  return position;
+}
+
+size_t Board::write_fen(Color player_turn, std::span<char, max_fen_length> buffer) const {
+  constexpr char white_piece_chars[] = " PBNRQK";
+  constexpr char black_piece_chars[] = " pbnrqk";
+
+  size_t length = 0;
+  const auto write = [&](char c) { buffer[length++] = c; };
+
+  // Pieces placement.
+  for (int y = 7; y >= 0; --y) {
+    int empty_fields = 0;
+
+    for (int x = 0; x < 8; ++x) {
+      const auto field = get_field(x, y);
+      if (!field.is_solid_piece()) {
+        empty_fields++;
+        continue;
+      }
+
+      if (empty_fields > 0) {
+        write(char('0' + empty_fields));
+        empty_fields = 0;
+      }
+
+      const auto piece_chars = field.color == Color::White ? white_piece_chars : black_piece_chars;
+      write(piece_chars[size_t(field.piece)]);
+    }
+
+    if (empty_fields > 0) {
+      write(char('0' + empty_fields));
+    }
+
+    if (y != 0) {
+      write('/');
+    }
+  }
+
+  // Player turn.
+  write(' ');
+  write(player_turn == Color::White ? 'w' : 'b');
+  write(' ');
+
+  // Castling rights.
+  const int rights = castling_rights(*this);
+  if (rights == 0) {
+    write('-');
+  }
+
+  if (rights & zobrist::castling_white_king_side) {
+    write('K');
+  }
+  if (rights & zobrist::castling_white_queen_side) {
+    write('Q');
+  }
+  if (rights & zobrist::castling_black_king_side) {
+    write('k');
+  }
+  if (rights & zobrist::castling_black_queen_side) {
+    write('q');
+  }
+
+  write(' ');
+
+  // En passant.
+  const bool en_passant_capturable = player_turn == Color::White
+                                       ? en_passant_targets<Color::White>(*this) != 0
+                                       : en_passant_targets<Color::Black>(*this) != 0;
+  if (en_passant_capturable) {
+    write(char('a' + en_passant->x));
+    write(char('1' + en_passant->y));
   } else {
-    result += "- ";
+    write('-');
   }
 
-  result += std::to_string(half_move_counter) + " " + std::to_string(full_move_number);
+  // Halfmove and fullmove counters. Both take at most 4 digits, so the buffer can't overflow.
+  const auto write_number = [&](int number) {
+    const auto end = buffer.data() + buffer.size();
+    const auto clamped = std::clamp(number, 0, max_fen_counter);
+    length = size_t(std::to_chars(buffer.data() + length, end, clamped).ptr - buffer.data());
+  };
 
-  return result;
+  write(' ');
+  write_number(half_move_counter);
+  write(' ');
+  write_number(full_move_number);
+
+  buffer[length] = '\0';
+
+  return length;
+}
+
+std::string Board::get_fen_string(Color player_turn) const {
+  char buffer[max_fen_length];
+  return std::string(buffer, write_fen(player_turn, buffer));
 }
\ No newline at end of file
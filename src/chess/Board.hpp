@@ -1,6 +1,15 @@
 #pragma once
+#include "Bitboard.hpp"
+#include "Zobrist.hpp"
+
 #include <array>
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -22,7 +31,6 @@ enum class Piece : uint8_t {
   Rook = 0b100,
   Queen = 0b101,
   King = 0b110,
-  PawnGhost = 0b111,
 };
 
 struct Field {
@@ -30,7 +38,7 @@ struct Field {
   Piece piece : 3 = Piece::None;
   bool moved : 1 = false;
 
-  bool is_solid_piece() const { return piece != Piece::None && piece != Piece::PawnGhost; }
+  bool is_solid_piece() const { return piece != Piece::None; }
 };
 static_assert(sizeof(Field) == 1, "Field must be one byte");
 
@@ -38,24 +46,204 @@ struct Position {
   uint8_t x : 4 = 0;
   uint8_t y : 4 = 0;
 
-  Position(int x, int y) : x(x), y(y) {}
+  constexpr Position() = default;
+  constexpr Position(int x, int y) : x(x), y(y) {}
+
+  constexpr static Position from_index(int index) { return Position(index % 8, index / 8); }
+  constexpr int index() const { return x + y * 8; }
 
-  bool operator==(const Position other) const { return x == other.x && y == other.y; }
-  bool operator!=(const Position other) const { return !(*this == other); }
+  constexpr bool operator==(const Position other) const { return x == other.x && y == other.y; }
+  constexpr bool operator!=(const Position other) const { return !(*this == other); }
 };
 static_assert(sizeof(Position) == 1, "Position must be one byte");
 
-struct Move {
-  Position from;
-  Position to;
-  bool captures : 1 = false;
-  bool promotes : 1 = false;
-  bool castles : 1 = false;
+namespace material {
+
+/// Most pieces (including the king) and pawns of one color which a board can hold.
+/// `Board::from_fen` rejects positions with more, and moves can't add pieces.
+constexpr int max_pieces = 16;
+constexpr int max_pawns = 8;
+
+/// Width of a slot in the material key.
+constexpr int slot_bits = 4;
+
+static_assert(max_pieces - 1 < (1 << slot_bits),
+              "Pieces other than the king of one color must fit into a material key slot");
+
+/// Contribution of a single piece to `Board::get_material_key`. The key packs the number of pieces
+/// of every type and color into 4-bit slots. Bishops on dark and light fields have separate slots
+/// and kings aren't counted. Counts stay below 16 only because of `max_pieces`; more pieces of one
+/// type would carry into the next slot.
+constexpr uint64_t piece_key(Color color, Piece piece, bool dark_square) {
+  if (piece == Piece::King || piece == Piece::None) {
+    return 0;
+  }
+
+  // Slot of the king is reused for bishops on dark fields.
+  const int slot =
+    piece == Piece::Bishop && dark_square ? int(Piece::King) - 1 : int(piece) - 1;
+
+  return uint64_t(1) << ((int(color) - 1) * 32 + slot * slot_bits);
+}
+
+/// Value of a piece in centipawns, used by static exchange evaluation. The king is worth more than
+/// all other pieces together, so exchanges never give it up.
+constexpr int piece_value(Piece piece) {
+  constexpr int values[] = {0, 100, 330, 320, 500, 900, 20000};
+  return values[size_t(piece)];
+}
+
+} // namespace material
+
+/// Subset of moves produced by a move generator.
+enum class MoveKind : uint8_t {
+  /// Moves which capture a piece (including en passant) and all promotions.
+  Captures,
+
+  /// All other moves (including castling).
+  Quiets,
+
+  All,
+};
+
+/// Move packed into 16 bits. Bits 0-5 hold the index of the origin field, bits 6-11 the index of
+/// the destination field and bits 12-15 `Move::Flags`.
+class Move {
+  uint16_t data;
+
+  constexpr static uint16_t capture_bit = 0b0100;
+  constexpr static uint16_t promotion_bit = 0b1000;
+
+public:
+  /// Promotion flags store the promoted piece as `Piece` value offset by `Piece::Bishop`.
+  enum class Flags : uint8_t {
+    Quiet = 0b0000,
+    DoublePawnPush = 0b0001,
+    Castles = 0b0010,
+    Capture = 0b0100,
+    EnPassant = 0b0101,
+    BishopPromotion = 0b1000,
+    KnightPromotion = 0b1001,
+    RookPromotion = 0b1010,
+    QueenPromotion = 0b1011,
+    BishopPromotionCapture = 0b1100,
+    KnightPromotionCapture = 0b1101,
+    RookPromotionCapture = 0b1110,
+    QueenPromotionCapture = 0b1111,
+  };
+
+  /// Leaves the move uninitialized so move lists can be created without writing to them.
+  Move() = default;
+
+  constexpr Move(Position from, Position to, Flags flags = Flags::Quiet)
+      : data(uint16_t(from.index() | (to.index() << 6) | (int(flags) << 12))) {}
+
+  constexpr static Flags promotion_flags(Piece piece, bool captures) {
+    return Flags(promotion_bit | (captures ? capture_bit : 0) | (int(piece) - int(Piece::Bishop)));
+  }
+
+  constexpr static Move from_raw(uint16_t raw) {
+    Move move;
+    move.data = raw;
+    return move;
+  }
+
+  constexpr uint16_t raw() const { return data; }
+
+  constexpr Position from() const { return Position::from_index(data & 0x3f); }
+  constexpr Position to() const { return Position::from_index((data >> 6) & 0x3f); }
+  constexpr Flags flags() const { return Flags(data >> 12); }
+
+  constexpr bool captures() const { return (data >> 12) & capture_bit; }
+  constexpr bool promotes() const { return (data >> 12) & promotion_bit; }
+  constexpr bool castles() const { return flags() == Flags::Castles; }
+  constexpr bool is_en_passant() const { return flags() == Flags::EnPassant; }
+  constexpr bool is_double_pawn_push() const { return flags() == Flags::DoublePawnPush; }
+
+  /// `MoveKind::Captures` or `MoveKind::Quiets`.
+  constexpr MoveKind kind() const {
+    return captures() || promotes() ? MoveKind::Captures : MoveKind::Quiets;
+  }
+
+  /// Piece which the pawn promotes to. `Piece::None` if the move doesn't promote.
+  constexpr Piece promotion() const {
+    return promotes() ? Piece(int(Piece::Bishop) + ((data >> 12) & 0b11)) : Piece::None;
+  }
+
+  constexpr bool operator==(const Move other) const { return data == other.data; }
+  constexpr bool operator!=(const Move other) const { return data != other.data; }
+};
+static_assert(sizeof(Move) == 2, "Move must be two bytes");
+
+/// Fixed-capacity list of moves which doesn't allocate. No reachable position has more than 218
+/// legal moves, so the capacity is enough for any generator. Boards always have both kings
+/// (`Board::from_fen` rejects positions without them), so generators never list pseudo-legal
+/// moves, whose number isn't bounded like that.
+class MoveList {
+public:
+  constexpr static size_t capacity = 256;
+
+private:
+  std::array<Move, capacity> moves;
+  size_t count = 0;
+
+public:
+  void push_back(const Move& move) {
+    assert(count < capacity);
+    moves[count++] = move;
+  }
+  void clear() { count = 0; }
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  const Move& operator[](size_t index) const { return moves[index]; }
+
+  const Move* begin() const { return moves.data(); }
+  const Move* end() const { return moves.data() + count; }
+
+  std::vector<Move> to_vector() const { return std::vector<Move>(begin(), end()); }
 };
 
-struct PlayerMove {
+/// State which `Board::make_move` overwrites and `Board::unmake_move` needs to restore.
+struct MoveUndo {
   Move move;
-  Piece promotion;
+
+  /// Fields at `move.from` and `move.to` before the move (including `moved` flags).
+  Field from_field;
+  Field to_field;
+
+  std::optional<Position> en_passant;
+
+  uint16_t half_move_counter = 0;
+  uint64_t hash = 0;
+};
+
+struct FenPosition;
+
+/// Describes why `Board::from_fen` or `Board::from_epd` rejected its input.
+struct FenError {
+  /// Offset of the invalid part in the FEN.
+  size_t offset = 0;
+
+  /// Static string, so reporting an error doesn't allocate.
+  const char* message = "";
+};
+
+/// Describes the enemy king of `player_turn` so that `Board::gives_check` can test moves without
+/// making them. Computed once per position with `Board::get_check_info`.
+struct CheckInfo {
+  Color player_turn = Color::None;
+
+  /// Square of the enemy king, -1 if there isn't one.
+  int king_square = -1;
+
+  /// Pieces of `player_turn` which are the only blocker between one of its sliders and the enemy
+  /// king. Moving them off that line gives a discovered check.
+  Bitboard discovered_candidates = 0;
+
+  /// Fields from which a piece of `player_turn` attacks the enemy king, indexed by `Piece`.
+  std::array<Bitboard, 7> check_fields{};
 };
 
 class Board {
@@ -67,32 +255,237 @@ class Board {
   /// The number of the full move. It starts at 1, and is incremented after Black's move.
   int full_move_number = 1;
 
-  uint8_t pawn_ghosts = 0;
+  /// Field skipped over by a pawn which has just moved by 2 places. The pawn can be captured en
+  /// passant by moving to this field, but only during the next move. It's set only if an enemy
+  /// pawn stands next to the moved one, so positions which differ only by an unusable en passant
+  /// field compare (and hash) equal.
+  std::optional<Position> en_passant;
+
+  /// Zobrist key of the position. Pieces are hashed by `set_field`, the rest by `make_move`.
+  uint64_t hash = 0;
+
+  /// Sum of `material::piece_key` of all pieces on the board.
+  uint64_t material_key = 0;
+
+  /// Fields occupied by every piece type, indexed by the raw `Piece` value.
+  std::array<Bitboard, 7> piece_bitboards{};
+
+  /// Fields occupied by pieces of every color, indexed by the raw `Color` value.
+  std::array<Bitboard, 3> color_bitboards{};
+
+  /// Index of the field with the king of every color (-1 if there is none), indexed by the raw
+  /// `Color` value.
+  std::array<int8_t, 3> king_squares{-1, -1, -1};
+
+  /// Creates a board without any pieces.
+  struct Empty {};
+  explicit Board(Empty) {}
+
+  /// Shared by `from_fen` and `from_epd`. In EPD mode stops after the en passant field and stores
+  /// the rest of the text in `operations` (if it isn't null).
+  static std::optional<FenPosition> parse_fen(std::string_view fen, bool epd,
+                                              std::string_view* operations, FenError* error);
 
   static inline size_t index_from_position(int x, int y) { return x + y * 8; }
 
-  void set_field(int x, int y, Field field) { fields[index_from_position(x, y)] = field; }
+  void set_field(int x, int y, Field field) {
+    const auto index = index_from_position(x, y);
+    const auto bit = bitboards::from_square(int(index));
+    const auto previous = fields[index];
+    const bool dark_square = bitboards::contains(bitboards::dark_squares, int(index));
+
+    if (previous.is_solid_piece()) {
+      piece_bitboards[size_t(previous.piece)] &= ~bit;
+      color_bitboards[size_t(previous.color)] &= ~bit;
+      hash ^= zobrist::piece(previous.color, previous.piece, int(index));
+      material_key -= material::piece_key(previous.color, previous.piece, dark_square);
+
+      if (previous.piece == Piece::King) {
+        king_squares[size_t(previous.color)] = -1;
+      }
+    }
+
+    if (field.is_solid_piece()) {
+      piece_bitboards[size_t(field.piece)] |= bit;
+      color_bitboards[size_t(field.color)] |= bit;
+      hash ^= zobrist::piece(field.color, field.piece, int(index));
+      material_key += material::piece_key(field.color, field.piece, dark_square);
+
+      if (field.piece == Piece::King) {
+        king_squares[size_t(field.color)] = int8_t(index);
+      }
+    }
+
+    fields[index] = field;
+  }
+
   void set_field(Position position, Field field) { set_field(position.x, position.y, field); }
 
-  std::vector<Move> calculate_moves_without_castling(Color player_turn) const;
-  std::vector<Move> calculate_moves_with_castling(Color player_turn) const;
+  // Generators and `make_move` are templated on the side to move, so color dependent values are
+  // constants. Public functions taking a `Color` dispatch to them once.
+
+  template <Color Us> void calculate_moves_without_castling(MoveList& moves) const;
+  void calculate_moves_with_castling(Color player_turn, MoveList& moves) const;
+
+  // `Moves` is either `MoveList` or a counter which only needs the number of moves.
+
+  template <Color Us, typename Moves> void add_castling_moves(Moves& moves) const;
+
+  /// Appends legal moves of `player_turn` which belong to `kind`.
+  void calculate_legal_moves(Color player_turn, MoveKind kind, MoveList& moves) const;
+  template <Color Us, typename Moves> void calculate_legal_moves(MoveKind kind, Moves& moves) const;
+
+  /// Appends moves which get the king out of check from `checkers` (one or two pieces).
+  template <Color Us, typename Moves>
+  void add_evasions(int king_square, Bitboard checkers, Moves& moves) const;
+
+  template <Color Us> bool has_legal_move() const;
+
+  template <Color Us> bool is_pseudo_legal(Move move) const;
+  template <Color Us> bool is_legal(Move move) const;
+
+  template <Color Us> MoveUndo make_move(Move move);
 
 public:
   Board();
 
+  /// Appends all legal moves of `player_turn` to `moves`.
+  void calculate_legal_moves(Color player_turn, MoveList& moves) const;
+
+  /// Appends legal captures and promotions of `player_turn` to `moves`.
+  void calculate_captures(Color player_turn, MoveList& moves) const;
+
+  /// Appends legal moves of `player_turn` which neither capture nor promote to `moves`.
+  void calculate_quiet_moves(Color player_turn, MoveList& moves) const;
+
+  /// Appends legal moves which get the king of `player_turn` out of check: king moves, captures of
+  /// the checking piece and blocks of its ray. Appends nothing if the king isn't in check.
+  void calculate_evasions(Color player_turn, MoveList& moves) const;
+
+  /// Number of legal moves of `player_turn`. Faster than generating them, as moves to a set of
+  /// fields are counted at once.
+  size_t count_legal_moves(Color player_turn) const;
+
+  /// Checks if `player_turn` has any legal move (so it's neither checkmated nor stalemated). Stops
+  /// at the first piece which can move.
+  bool has_legal_move(Color player_turn) const;
+
+  /// Allocating variant for callers which need to keep the moves around (like the UI).
   std::vector<Move> calculate_legal_moves(Color player_turn) const;
   bool is_king_under_attack(Color player_turn) const;
+
+  /// Checks if any piece of `by` attacks `position`. Works backwards from the target field, so it
+  /// doesn't need to generate moves of `by`.
+  bool is_square_attacked(Position position, Color by) const;
   bool is_material_insufficient() const;
 
-  void make_move(const Move& move, Piece promotion);
-  void make_move(const PlayerMove& player_move);
+  /// Static exchange evaluation of `move`: material (see `material::piece_value`) which the moving
+  /// side gains if both sides keep capturing on the destination with their least valuable piece,
+  /// and either can stop when continuing would lose. Sliders behind other attackers join once the
+  /// pieces in front of them have captured. Pins and promotions after the first move are ignored.
+  int see(Move move) const;
+
+  /// Checks if `see(move) >= threshold`, stopping as soon as the answer is known.
+  bool see_ge(Move move, int threshold) const;
+
+  /// Checks if `move` of `player_turn` follows the movement rules with flags matching the position,
+  /// ignoring whether it leaves the king attacked. Castling is checked fully. Any 16-bit value (for
+  /// example from a hash table) can be tested.
+  bool is_pseudo_legal(Color player_turn, Move move) const;
+
+  /// Checks if `move` of `player_turn` is legal without generating other moves or making it. Uses
+  /// pins and checkers, so it takes constant time.
+  bool is_legal(Color player_turn, Move move) const;
+
+  /// Computes `CheckInfo` for moves of `player_turn`.
+  CheckInfo get_check_info(Color player_turn) const;
+
+  /// Checks if legal `move` gives check, using `info` computed for the side making it. Most moves
+  /// are decided with a single lookup. Compute `info` once when testing many moves of a position.
+  bool gives_check(Move move, const CheckInfo& info) const;
+  bool gives_check(Move move) const;
+
+  MoveUndo make_move(Move move);
 
+  /// Reverts the last move made on this board. Moves must be unmade in the reverse order.
+  void unmake_move(const MoveUndo& undo);
+
+  /// Loads a position from FEN without allocating. Castling rights are converted to `moved` flags
+  /// of kings and rooks and the en passant field is kept only if it can be captured on. Halfmove
+  /// and fullmove counters may be omitted and can't exceed `max_fen_counter`. Every color must
+  /// have one king and at most 16 pieces, 8 of them pawns. Fields may be separated by any
+  /// whitespace. Returns `std::nullopt` if `fen` isn't valid and describes the problem in `error`
+  /// (if it isn't null).
+  static std::optional<FenPosition> from_fen(std::string_view fen, FenError* error = nullptr);
+
+  /// Loads a position from an EPD line: the first 4 fields of FEN followed by operations (like
+  /// `bm e4; id "x";`). Operations aren't interpreted; the text after the en passant field (without
+  /// surrounding whitespace, like a line ending) is stored in `operations` (if it isn't null).
+  /// Errors are reported like in `from_fen`.
+  static std::optional<FenPosition> from_epd(std::string_view epd,
+                                             std::string_view* operations = nullptr,
+                                             FenError* error = nullptr);
+
+  /// Largest halfmove counter and fullmove number in FEN. No game reaches it, and limiting them to
+  /// 4 digits bounds the length of FEN.
+  constexpr static int max_fen_counter = 9999;
+
+  /// Size of the buffer which `write_fen` needs: the longest FEN with counters up to
+  /// `max_fen_counter` and the terminating null character.
+  constexpr static size_t max_fen_length = 92;
+
+  /// Writes FEN of the position into `buffer` without allocating and returns its length (without
+  /// the terminating null character).
+  size_t write_fen(Color player_turn, std::span<char, max_fen_length> buffer) const;
   std::string get_fen_string(Color player_turn) const;
 
   int get_moves_since_capture_or_pawn_move() const { return half_move_counter / 2; }
+  int get_half_move_counter() const { return half_move_counter; }
+
+  std::optional<Position> get_en_passant() const { return en_passant; }
+
+  /// Zobrist key covering pieces, side to move, castling rights and en passant file. The side to
+  /// move isn't stored in the board: keys of positions with black to move include `zobrist::side`
+  /// and `make_move` toggles it, assuming that sides alternate on every move.
+  uint64_t get_hash() const { return hash; }
+
+  /// Number of pieces of every type and color (see `material::piece_key`). Positions with the same
+  /// material have the same key regardless of where the pieces stand.
+  uint64_t get_material_key() const { return material_key; }
+
+  /// Positions are equal if the same pieces stand on the same fields and the en passant field and
+  /// the key (which covers the side to move and castling rights) match. Like the key, this ignores
+  /// counters, so equal positions count as repetitions. Makes `Board` usable in hashed containers.
+  bool operator==(const Board& other) const {
+    return piece_bitboards == other.piece_bitboards &&
+           color_bitboards == other.color_bitboards && en_passant == other.en_passant &&
+           hash == other.hash;
+  }
 
   Field get_field(int x, int y) const { return fields[index_from_position(x, y)]; }
   Field get_field(Position position) const { return get_field(position.x, position.y); }
+
+  Bitboard get_pieces(Piece piece) const { return piece_bitboards[size_t(piece)]; }
+  Bitboard get_pieces(Color color) const { return color_bitboards[size_t(color)]; }
+  Bitboard get_pieces(Color color, Piece piece) const {
+    return get_pieces(piece) & get_pieces(color);
+  }
+
+  std::optional<Position> get_king_position(Color color) const {
+    const int square = king_squares[size_t(color)];
+    return square >= 0 ? std::optional(Position::from_index(square)) : std::nullopt;
+  }
+
+  Bitboard get_occupied() const {
+    return color_bitboards[size_t(Color::White)] | color_bitboards[size_t(Color::Black)];
+  }
+};
+
+/// Position loaded by `Board::from_fen`. The side to move isn't part of `Board`, so it's returned
+/// alongside it.
+struct FenPosition {
+  Board board;
+  Color player_turn = Color::White;
 };
 
 } // namespace chess
@@ -105,4 +498,8 @@ template <> struct hash<chess::Position> {
   }
 };
 
+template <> struct hash<chess::Board> {
+  std::size_t operator()(const chess::Board& board) const { return board.get_hash(); }
+};
+
 } // namespace std
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "BotIntegration.hpp"
+#include "Notation.hpp"
 
 #include <array>
 #include <filesystem>
@@ -96,32 +97,17 @@ BotIntegration::BotIntegration(const std::string& engine_path) : process(engine_
         std::exit(1);
       }
 
-      const auto parse_position = [&](std::string_view s) {
-        return uint32_t(s[0] - 'a') | (uint32_t(s[1] - '1') << 4);
-      };
-
-      auto move = (parse_position(best_move.substr(0, 2)) << 0) |
-                  (parse_position(best_move.substr(2, 4)) << 8);
-
-      // Promotion.
-      if (best_move.size() == 5) {
-        Piece piece = Piece::None;
-
-        const auto c = best_move[4];
-        if (c == 'q' || c == 'Q') {
-          piece = Piece::Queen;
-        } else if (c == 'n' || c == 'N') {
-          piece = Piece::Knight;
-        } else if (c == 'b' || c == 'B') {
-          piece = Piece::Bishop;
-        } else if (c == 'r' || c == 'R') {
-          piece = Piece::Rook;
-        }
+      const auto position = Board::from_fen(fen);
+      const auto move =
+        position ? notation::parse_uci(position->board, position->player_turn, best_move)
+                 : std::nullopt;
 
-        move |= uint32_t(piece) << 16;
+      // The engine answered with a move which isn't legal in the position.
+      if (!move) {
+        std::exit(1);
       }
 
-      best_move_atomic.store(move);
+      best_move_atomic.store(move->raw());
     }
   });
 }
@@ -138,14 +124,13 @@ void BotIntegration::queue_best_move_calculation(const Board& board, Color playe
   auto fen = board.get_fen_string(player_turn);
 
   if (!is_calculation_queued) {
-    queue_best_move_calculation(board.get_fen_string(player_turn));
+    queue_best_move_calculation(std::move(fen));
   } else {
     pending_fen = std::move(fen);
   }
 }
 
-std::optional<PlayerMove>
-BotIntegration::get_best_move(const std::vector<chess::Move>& all_possible_moves) {
+std::optional<Move> BotIntegration::get_best_move() {
   const auto best_move = best_move_atomic.load();
   if (best_move == invalid_best_move) {
     return std::nullopt;
@@ -161,18 +146,7 @@ BotIntegration::get_best_move(const std::vector<chess::Move>& all_possible_moves
     return std::nullopt;
   }
 
-  const auto from = Position(int((best_move >> 0) & 0xf), int((best_move >> 4) & 0xf));
-  const auto to = Position(int((best_move >> 8) & 0xf), int((best_move >> 12) & 0xf));
-  const auto promotion = Piece((best_move >> 16) & 0xf);
-
-  for (const auto move : all_possible_moves) {
-    if (move.from == from && move.to == to) {
-      return PlayerMove{move, promotion};
-    }
-  }
-
-  // This is bad.
-  std::exit(1);
+  return Move::from_raw(best_move);
 }
 
 std::unique_ptr<BotIntegration> chess::create_bot_integration() {
@@ -11,7 +11,8 @@
 namespace chess {
 
 class BotIntegration {
-  constexpr static uint32_t invalid_best_move = 0xffffffff;
+  /// Raw value of a move from a1 to a1, which is never legal.
+  constexpr static uint16_t invalid_best_move = 0;
 
   Process process;
   std::thread thread;
@@ -20,7 +21,7 @@ class BotIntegration {
   std::condition_variable fen_cv;
   std::string queued_fen;
 
-  std::atomic_uint32_t best_move_atomic = invalid_best_move;
+  std::atomic_uint16_t best_move_atomic = invalid_best_move;
   std::atomic_bool exit_thread = false;
 
   bool is_calculation_queued = false;
@@ -37,7 +38,8 @@ public:
   ~BotIntegration();
 
   void queue_best_move_calculation(const Board& board, Color player_turn);
-  std::optional<PlayerMove> get_best_move(const std::vector<chess::Move>& all_possible_moves);
+  /// Returns the move found by the engine (already resolved against the position) once it's ready.
+  std::optional<Move> get_best_move();
 };
 
 std::unique_ptr<BotIntegration> create_bot_integration();
@@ -0,0 +1,67 @@
+#include "MoveGenerator.hpp"
+
+using namespace chess;
+
+static_assert(size_t(MoveKind::Captures) == 0 && size_t(MoveKind::Quiets) == 1,
+              "Move lists in `MoveGenerator` are indexed by `MoveKind` values");
+
+MoveGenerator::MoveGenerator(const Board& board, Color player_turn, std::optional<Move> hash_move)
+    : board(board), player_turn(player_turn), hash_move(hash_move) {}
+
+const MoveList& MoveGenerator::get_moves(MoveKind kind) {
+  const auto index = size_t(kind);
+
+  if (!generated[index]) {
+    if (kind == MoveKind::Captures) {
+      board.calculate_captures(player_turn, moves[index]);
+    } else {
+      board.calculate_quiet_moves(player_turn, moves[index]);
+    }
+    generated[index] = true;
+  }
+
+  return moves[index];
+}
+
+std::optional<Move> MoveGenerator::next() {
+  while (true) {
+    switch (stage) {
+    case Stage::HashMove: {
+      stage = Stage::Captures;
+
+      if (hash_move) {
+        // Hash move may come from a different position. Return it only if it's legal here. It's
+        // checked directly, so a cutoff on it skips move generation entirely.
+        if (board.is_legal(player_turn, *hash_move)) {
+          return hash_move;
+        }
+
+        hash_move = std::nullopt;
+      }
+
+      break;
+    }
+
+    case Stage::Captures:
+    case Stage::Quiets: {
+      const auto& stage_moves =
+        get_moves(stage == Stage::Captures ? MoveKind::Captures : MoveKind::Quiets);
+
+      while (index < stage_moves.size()) {
+        const auto move = stage_moves[index++];
+        if (move != hash_move) {
+          return move;
+        }
+      }
+
+      index = 0;
+      stage = stage == Stage::Captures ? Stage::Quiets : Stage::Done;
+
+      break;
+    }
+
+    case Stage::Done:
+      return std::nullopt;
+    }
+  }
+}
\ No newline at end of file
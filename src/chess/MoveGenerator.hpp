@@ -0,0 +1,45 @@
+#pragma once
+#include "Board.hpp"
+
+#include <array>
+#include <optional>
+
+namespace chess {
+
+/// Returns legal moves one at a time. Moves are produced in stages (hash move, captures, quiet
+/// moves) and every stage is generated only when the previous one is exhausted, so consumers which
+/// stop early (search cutoffs, checking if any legal move exists) don't pay for the rest.
+///
+/// The board must outlive the generator and must not be modified while it's in use.
+class MoveGenerator {
+  enum class Stage : uint8_t {
+    HashMove,
+    Captures,
+    Quiets,
+    Done,
+  };
+
+  const Board& board;
+  Color player_turn;
+  std::optional<Move> hash_move;
+
+  Stage stage = Stage::HashMove;
+  size_t index = 0;
+
+  /// Indexed by the raw `MoveKind` value (captures and quiets only).
+  std::array<MoveList, 2> moves;
+  std::array<bool, 2> generated{};
+
+  const MoveList& get_moves(MoveKind kind);
+
+public:
+  /// `hash_move` (for example from a transposition table) is returned first if it's legal and is
+  /// skipped in later stages.
+  MoveGenerator(const Board& board, Color player_turn,
+                std::optional<Move> hash_move = std::nullopt);
+
+  /// Returns the next legal move or `std::nullopt` if there are no more moves.
+  std::optional<Move> next();
+};
+
+} // namespace chess
\ No newline at end of file
@@ -0,0 +1,300 @@
+#include "Notation.hpp"
+#include "Attacks.hpp"
+
+#include <array>
+#include <cstdlib>
+
+using namespace chess;
+
+/// Piece letters indexed by the raw `Piece` value. SAN uses uppercase letters, UCI uses lowercase
+/// letters for promotions.
+static constexpr char san_piece_chars[] = " PBNRQK";
+static constexpr char uci_piece_chars[] = " pbnrqk";
+
+/// Piece for every character, `Piece::None` for characters which aren't piece letters.
+static constexpr auto char_pieces = [] {
+  std::array<Piece, 256> table{};
+
+  for (size_t i = 1; i < 7; ++i) {
+    table[uint8_t(san_piece_chars[i])] = Piece(i);
+    table[uint8_t(uci_piece_chars[i])] = Piece(i);
+  }
+
+  return table;
+}();
+
+static Piece piece_from_char(char c) { return char_pieces[uint8_t(c)]; }
+
+/// SAN uses only uppercase piece letters, lowercase letters are files.
+static bool is_san_piece(char c) {
+  return c >= 'A' && c <= 'Z' && piece_from_char(c) != Piece::None;
+}
+
+static std::optional<Position> parse_square(std::string_view text) {
+  if (text.size() != 2 || text[0] < 'a' || text[0] > 'h' || text[1] < '1' || text[1] > '8') {
+    return std::nullopt;
+  }
+
+  return Position(text[0] - 'a', text[1] - '1');
+}
+
+/// Completes a move given by its fields with flags which depend on the position. Returns
+/// `std::nullopt` if the move isn't legal.
+static std::optional<Move> resolve_move(const Board& board, Color player_turn, Position from,
+                                        Position to, Piece promotion) {
+  const auto piece = board.get_field(from).piece;
+  const bool captures = board.get_field(to).is_solid_piece();
+
+  auto flags = captures ? Move::Flags::Capture : Move::Flags::Quiet;
+
+  if (promotion != Piece::None) {
+    if (piece != Piece::Pawn || promotion == Piece::Pawn || promotion == Piece::King) {
+      return std::nullopt;
+    }
+
+    flags = Move::promotion_flags(promotion, captures);
+  } else if (piece == Piece::Pawn) {
+    if (std::abs(to.y - from.y) == 2) {
+      flags = Move::Flags::DoublePawnPush;
+    } else if (to.x != from.x && !captures && board.get_en_passant() == to) {
+      flags = Move::Flags::EnPassant;
+    }
+  } else if (piece == Piece::King && to.y == from.y && std::abs(to.x - from.x) == 2) {
+    flags = Move::Flags::Castles;
+  }
+
+  const auto move = Move(from, to, flags);
+  if (!board.is_legal(player_turn, move)) {
+    return std::nullopt;
+  }
+
+  return move;
+}
+
+size_t notation::write_uci(Move move, std::span<char, max_uci_length> buffer) {
+  size_t length = 0;
+
+  for (const auto position : {move.from(), move.to()}) {
+    buffer[length++] = char('a' + position.x);
+    buffer[length++] = char('1' + position.y);
+  }
+
+  if (move.promotes()) {
+    buffer[length++] = uci_piece_chars[size_t(move.promotion())];
+  }
+
+  buffer[length] = '\0';
+
+  return length;
+}
+
+size_t notation::write_san(const Board& board, Color player_turn, Move move,
+                           std::span<char, max_san_length> buffer) {
+  size_t length = 0;
+  const auto write = [&](char c) { buffer[length++] = c; };
+
+  const auto from = move.from();
+  const auto to = move.to();
+  const auto piece = board.get_field(from).piece;
+
+  const auto write_square = [&](Position position) {
+    write(char('a' + position.x));
+    write(char('1' + position.y));
+  };
+
+  if (move.castles()) {
+    for (const char c : std::string_view(to.x < from.x ? "O-O-O" : "O-O")) {
+      write(c);
+    }
+  } else if (piece == Piece::Pawn) {
+    if (move.captures()) {
+      write(char('a' + from.x));
+      write('x');
+    }
+
+    write_square(to);
+
+    if (move.promotes()) {
+      write('=');
+      write(san_piece_chars[size_t(move.promotion())]);
+    }
+  } else {
+    write(san_piece_chars[size_t(piece)]);
+
+    // Other pieces of the same type which can move to the same field. The file of the moving piece
+    // is preferred for disambiguation, then its rank, then both.
+    auto others = attacks::piece(piece, to.index(), board.get_occupied()) &
+                  board.get_pieces(player_turn, piece) & ~bitboards::from_square(from.index());
+
+    bool ambiguous = false;
+    bool same_file = false;
+    bool same_rank = false;
+
+    while (others) {
+      const auto other = Position::from_index(bitboards::pop_square(others));
+
+      if (resolve_move(board, player_turn, other, to, Piece::None)) {
+        ambiguous = true;
+        same_file |= other.x == from.x;
+        same_rank |= other.y == from.y;
+      }
+    }
+
+    if (ambiguous && (!same_file || same_rank)) {
+      write(char('a' + from.x));
+    }
+
+    if (ambiguous && same_file) {
+      write(char('1' + from.y));
+    }
+
+    if (move.captures()) {
+      write('x');
+    }
+
+    write_square(to);
+  }
+
+  // Only checking moves need to be made, to tell a check from a mate.
+  if (board.gives_check(move)) {
+    const auto opponent = other_color(player_turn);
+
+    auto board_after = board;
+    board_after.make_move(move);
+
+    write(board_after.has_legal_move(opponent) ? '+' : '#');
+  }
+
+  buffer[length] = '\0';
+
+  return length;
+}
+
+std::optional<Move> notation::parse_uci(const Board& board, Color player_turn,
+                                        std::string_view text) {
+  if (text.size() != 4 && text.size() != 5) {
+    return std::nullopt;
+  }
+
+  const auto from = parse_square(text.substr(0, 2));
+  const auto to = parse_square(text.substr(2, 2));
+
+  if (!from || !to) {
+    return std::nullopt;
+  }
+
+  auto promotion = Piece::None;
+
+  if (text.size() == 5) {
+    promotion = piece_from_char(text[4]);
+    if (promotion == Piece::None) {
+      return std::nullopt;
+    }
+  }
+
+  return resolve_move(board, player_turn, *from, *to, promotion);
+}
+
+std::optional<Move> notation::parse_san(const Board& board, Color player_turn,
+                                        std::string_view text) {
+  while (!text.empty() && (text.back() == '+' || text.back() == '#' || text.back() == '!' ||
+                           text.back() == '?')) {
+    text.remove_suffix(1);
+  }
+
+  if (text == "O-O" || text == "0-0" || text == "O-O-O" || text == "0-0-0") {
+    const auto king = board.get_king_position(player_turn);
+    const int to_x = king ? king->x + (text.size() == 3 ? 2 : -2) : -1;
+
+    if (to_x < 0 || to_x >= 8) {
+      return std::nullopt;
+    }
+
+    return resolve_move(board, player_turn, *king, Position(to_x, king->y), Piece::None);
+  }
+
+  // Promotion, with or without `=`.
+  auto promotion = Piece::None;
+
+  if (text.size() > 2 && is_san_piece(text.back())) {
+    promotion = piece_from_char(text.back());
+    text.remove_suffix(1);
+
+    if (text.back() == '=') {
+      text.remove_suffix(1);
+    }
+  }
+
+  if (text.size() < 2) {
+    return std::nullopt;
+  }
+
+  const auto to = parse_square(text.substr(text.size() - 2));
+  if (!to) {
+    return std::nullopt;
+  }
+
+  text.remove_suffix(2);
+
+  auto piece = Piece::Pawn;
+
+  if (!text.empty() && is_san_piece(text.front())) {
+    piece = piece_from_char(text.front());
+    text.remove_prefix(1);
+  }
+
+  bool captures = false;
+
+  if (!text.empty() && text.back() == 'x') {
+    captures = true;
+    text.remove_suffix(1);
+  }
+
+  // What is left is the file and/or the rank of the moving piece.
+  if (text.size() > 2) {
+    return std::nullopt;
+  }
+
+  auto from_mask = ~Bitboard(0);
+
+  for (const char c : text) {
+    if (c >= 'a' && c <= 'h') {
+      from_mask &= bitboards::file_a << (c - 'a');
+    } else if (c >= '1' && c <= '8') {
+      from_mask &= bitboards::rank_1 << (8 * (c - '1'));
+    } else {
+      return std::nullopt;
+    }
+  }
+
+  const int to_square = to->index();
+  auto candidates = board.get_pieces(player_turn, piece) & from_mask;
+
+  if (piece == Piece::Pawn) {
+    const auto backwards = player_turn == Color::White ? bitboards::south : bitboards::north;
+    const auto target = bitboards::from_square(to_square);
+
+    // Pawns which could capture on the field or push to it by one or two places.
+    candidates &= captures ? attacks::pawn(other_color(player_turn), to_square)
+                           : backwards(target) | backwards(backwards(target));
+  } else {
+    candidates &= attacks::piece(piece, to_square, board.get_occupied());
+  }
+
+  std::optional<Move> result;
+
+  while (candidates) {
+    const auto from = Position::from_index(bitboards::pop_square(candidates));
+
+    if (const auto move = resolve_move(board, player_turn, from, *to, promotion)) {
+      // More than one piece fits the description.
+      if (result) {
+        return std::nullopt;
+      }
+
+      result = move;
+    }
+  }
+
+  return result;
+}
\ No newline at end of file
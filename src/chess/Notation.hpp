@@ -0,0 +1,43 @@
+#pragma once
+#include "Board.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace chess {
+
+/// Conversion of moves to and from UCI (`e2e4`, `e7e8q`) and SAN (`Nbd7`, `exd8=Q+`, `O-O`)
+/// notation. Nothing here allocates: moves are written into fixed-size buffers and parsed from
+/// string views.
+namespace notation {
+
+/// Size of the buffer for `write_uci`, including the terminating null character.
+constexpr size_t max_uci_length = 6;
+
+/// Size of the buffer for `write_san`, including the terminating null character. The longest
+/// moves are fully disambiguated piece captures with check (`Qa1xb2+`) and capturing promotions
+/// with check (`exd8=Q+`).
+constexpr size_t max_san_length = 8;
+
+/// Writes `move` in UCI notation and returns its length (without the terminating null character).
+size_t write_uci(Move move, std::span<char, max_uci_length> buffer);
+
+/// Writes `move` of `player_turn` in SAN and returns its length (without the terminating null
+/// character). `move` must be legal in the position.
+size_t write_san(const Board& board, Color player_turn, Move move,
+                 std::span<char, max_san_length> buffer);
+
+/// Parses a move in UCI notation and resolves its flags against the position. Returns
+/// `std::nullopt` if the text isn't valid or the move isn't legal.
+std::optional<Move> parse_uci(const Board& board, Color player_turn, std::string_view text);
+
+/// Parses a move in SAN. Check and annotation suffixes (`+`, `#`, `!`, `?`) are ignored and
+/// castling may be written with zeros. Returns `std::nullopt` if the text isn't valid or doesn't
+/// describe exactly one legal move.
+std::optional<Move> parse_san(const Board& board, Color player_turn, std::string_view text);
+
+} // namespace notation
+
+} // namespace chess
\ No newline at end of file
@@ -0,0 +1,23 @@
+#include "RepetitionHistory.hpp"
+
+#include <algorithm>
+
+using namespace chess;
+
+int RepetitionHistory::count_occurrences(const Board& board) const {
+  const auto key = board.get_hash();
+
+  // Positions with the same side to move are 2 plies apart. Nothing before the last irreversible
+  // move can be the same position.
+  const auto plies = std::min(keys.size(), size_t(board.get_half_move_counter()));
+
+  int occurrences = 1;
+
+  for (size_t ply = 2; ply <= plies; ply += 2) {
+    if (keys[keys.size() - ply] == key) {
+      occurrences++;
+    }
+  }
+
+  return occurrences;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+#include "Board.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace chess {
+
+/// Zobrist keys of positions which preceded the current one, used to detect repetitions by
+/// comparing keys instead of boards. The game pushes the position before every move. A search can
+/// share the same history by pushing before `make_move` and popping after `unmake_move`.
+class RepetitionHistory {
+  std::vector<uint64_t> keys;
+
+public:
+  /// Records `board` as a position which is about to be left by a move.
+  void push(const Board& board) { keys.push_back(board.get_hash()); }
+  void pop() { keys.pop_back(); }
+  void clear() { keys.clear(); }
+
+  /// Number of recorded positions.
+  size_t size() const { return keys.size(); }
+
+  /// Forgets all positions but the first `size`, for example when a game continues from an
+  /// earlier position.
+  void truncate(size_t size) { keys.resize(std::min(size, keys.size())); }
+
+  /// Number of times `board` has occurred, including the current occurrence. Only positions since
+  /// the last capture or pawn move are scanned, as earlier ones can't repeat.
+  int count_occurrences(const Board& board) const;
+
+  /// The position repeated at least once. Enough to score it as a draw in a search.
+  bool is_repeated(const Board& board) const { return count_occurrences(board) >= 2; }
+
+  /// The position occurred for the third time, so either player can claim a draw.
+  bool is_threefold_repetition(const Board& board) const { return count_occurrences(board) >= 3; }
+
+  /// The position occurred for the fifth time, so the game is drawn automatically.
+  bool is_fivefold_repetition(const Board& board) const { return count_occurrences(board) >= 5; }
+};
+
+} // namespace chess
\ No newline at end of file
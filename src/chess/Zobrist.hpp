@@ -0,0 +1,81 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace chess {
+
+enum class Color : uint8_t;
+enum class Piece : uint8_t;
+
+namespace zobrist {
+
+namespace detail {
+
+/// SplitMix64 generator. Keys are generated at compile time so they are the same in every build.
+constexpr uint64_t next_random(uint64_t& state) {
+  uint64_t result = (state += 0x9e3779b97f4a7c15ull);
+  result = (result ^ (result >> 30)) * 0xbf58476d1ce4e5b9ull;
+  result = (result ^ (result >> 27)) * 0x94d049bb133111ebull;
+  return result ^ (result >> 31);
+}
+
+struct Keys {
+  /// Indexed by the raw `Color` value, the raw `Piece` value and the square.
+  std::array<std::array<std::array<uint64_t, 64>, 7>, 3> pieces{};
+
+  /// Indexed by the castling rights mask (see `castling_*` constants).
+  std::array<uint64_t, 16> castling{};
+
+  std::array<uint64_t, 8> en_passant_file{};
+  uint64_t side = 0;
+};
+
+constexpr Keys make_keys() {
+  Keys keys;
+  uint64_t state = 0x2d358dccaa6c78a5ull;
+
+  for (auto& pieces : keys.pieces) {
+    for (auto& squares : pieces) {
+      for (auto& key : squares) {
+        key = next_random(state);
+      }
+    }
+  }
+
+  for (auto& key : keys.castling) {
+    key = next_random(state);
+  }
+
+  for (auto& key : keys.en_passant_file) {
+    key = next_random(state);
+  }
+
+  keys.side = next_random(state);
+
+  return keys;
+}
+
+inline constexpr Keys keys = make_keys();
+
+} // namespace detail
+
+constexpr int castling_white_queen_side = 1 << 0;
+constexpr int castling_white_king_side = 1 << 1;
+constexpr int castling_black_queen_side = 1 << 2;
+constexpr int castling_black_king_side = 1 << 3;
+
+constexpr uint64_t piece(Color color, Piece piece, int square) {
+  return detail::keys.pieces[size_t(color)][size_t(piece)][square];
+}
+
+constexpr uint64_t castling(int rights) { return detail::keys.castling[rights]; }
+constexpr uint64_t en_passant(int file) { return detail::keys.en_passant_file[file]; }
+
+/// Toggled on every move, so positions with the same pieces but a different side to move have
+/// different keys.
+constexpr uint64_t side() { return detail::keys.side; }
+
+} // namespace zobrist
+
+} // namespace chess
\ No newline at end of file
@@ -19,11 +19,15 @@ bool ChessGame::is_bot_turn() {
 
 bool ChessGame::is_player_playing() { return !is_bot_turn(); }
 
-void ChessGame::make_move(chess::Move move, chess::Piece promotion) {
-  state.last_move = {move.from, move.to};
+void ChessGame::make_move(chess::Move move) {
+  state.last_move = {move.from(), move.to()};
   pending_move = std::nullopt;
 
-  state.board.make_move(move, promotion);
+  repetitions.truncate(state.ply);
+  repetitions.push(state.board);
+
+  state.board.make_move(move);
+  state.ply++;
 
   state.player_turn = chess::other_color(state.player_turn);
 
@@ -58,7 +62,7 @@ void ChessGame::on_turn_begin_no_history() {
   pending_move = std::nullopt;
   moved_position = std::nullopt;
 
-  all_possible_moves = state.board.calculate_legal_moves(state.player_turn);
+  all_possible_moves.clear();
   king_under_attack = state.board.is_king_under_attack(state.player_turn);
 
   const auto game_over = [&](const std::string& reason) {
@@ -66,7 +70,13 @@ void ChessGame::on_turn_begin_no_history() {
     view_manager.set_view(chess_views.game_over);
   };
 
-  if (all_possible_moves.empty()) {
+  // Earlier states are viewed with positions which came after them still recorded. They were
+  // checked for repetitions when they were played, so only the latest state is checked.
+  const bool is_repeated =
+    state.ply == repetitions.size() && repetitions.is_threefold_repetition(state.board);
+
+  // Full list of moves is needed only if the game continues.
+  if (!state.board.has_legal_move(state.player_turn)) {
     if (king_under_attack) {
       const auto winner =
         chess::other_color(state.player_turn) == chess::Color::White ? "White" : "Black";
@@ -79,7 +89,11 @@ void ChessGame::on_turn_begin_no_history() {
     game_over("Draw via insufficient material");
   } else if (state.board.get_moves_since_capture_or_pawn_move() >= 50) {
     game_over("Draw via 50 move rule");
+  } else if (is_repeated) {
+    game_over("Draw via threefold repetition");
   } else {
+    all_possible_moves = state.board.calculate_legal_moves(state.player_turn);
+
     const auto player = state.player_turn == chess::Color::White ? "white" : "black";
     const auto title = "Chess [" + std::string(player) + " are playing]";
     window.set_title(title);
@@ -110,8 +124,10 @@ void ChessGame::on_piece_grab(chess::Position position) {
   current_move_destinations.clear();
 
   for (const auto& move : all_possible_moves) {
-    if (move.from == position) {
-      current_move_destinations.insert(std::pair{move.to, &move});
+    // Promotions to different pieces share the destination. Only the first one is kept, the
+    // piece is picked later by the promotion selector.
+    if (move.from() == position) {
+      current_move_destinations.insert(std::pair{move.to(), &move});
     }
   }
 }
@@ -124,7 +140,7 @@ void ChessGame::on_piece_drop(chess::Position from, chess::Position to) {
 
   const auto& move = *possible_move_it->second;
 
-  if (move.promotes) {
+  if (move.promotes()) {
     pending_move = move;
 
     // Move cursor to the center of `to` field so it looks better.
@@ -135,7 +151,7 @@ void ChessGame::on_piece_drop(chess::Position from, chess::Position to) {
     chess_views.promotion_selector->set_color(state.player_turn);
     view_manager.set_view(chess_views.promotion_selector);
   } else {
-    make_move(move, chess::Piece::Queen);
+    make_move(move);
   }
 }
 
@@ -152,6 +168,7 @@ void ChessGame::reset_game() {
 
   state = State{};
   history = History{};
+  repetitions.clear();
 
   on_turn_begin();
 }
@@ -193,7 +210,7 @@ void ChessGame::draw_board() {
 
       const auto it = current_move_destinations.find(position);
       if (it != end(current_move_destinations)) {
-        if (it->second->captures) {
+        if (it->second->captures()) {
           const int radius = board_field_size / 2 - 2;
           const int thickness = board_field_size / 12;
 
@@ -351,7 +368,8 @@ void ChessGame::on_switched_view(View* before) {
 
   if (before == chess_views.promotion_selector) {
     if (const auto promotion_piece = chess_views.promotion_selector->get_selected_piece()) {
-      make_move(*pending_move, *promotion_piece);
+      const auto flags = chess::Move::promotion_flags(*promotion_piece, pending_move->captures());
+      make_move(chess::Move(pending_move->from(), pending_move->to(), flags));
     } else {
       pending_move = std::nullopt;
       on_piece_return();
@@ -360,7 +378,6 @@ void ChessGame::on_switched_view(View* before) {
 
   if (before == chess_views.waiting_for_player &&
       !chess_views.waiting_for_player->was_interrupted()) {
-    const auto player_move = *chess_views.waiting_for_player->get_player_move();
-    make_move(player_move.move, player_move.promotion);
+    make_move(*chess_views.waiting_for_player->get_player_move());
   }
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <chess/Board.hpp>
 #include <chess/BotIntegration.hpp>
+#include <chess/RepetitionHistory.hpp>
 #include <core/MessageBox.hpp>
 
 #include <optional>
@@ -15,6 +16,10 @@ class ChessGame : public ChessView {
     chess::Board board;
     chess::Color player_turn = chess::Color::White;
     std::optional<std::pair<chess::Position, chess::Position>> last_move = std::nullopt;
+
+    /// Number of moves made before this state. Positions before them are the first `ply` entries
+    /// of `ChessGame::repetitions`.
+    size_t ply = 0;
   };
 
   struct History {
@@ -40,6 +45,11 @@ class ChessGame : public ChessView {
   State state;
   History history;
 
+  /// Positions before every move of the latest line of the game. It's kept once instead of in
+  /// every state: going back in history keeps later positions, so going forward again needs
+  /// nothing, and a move made from an earlier state truncates it to that state.
+  chess::RepetitionHistory repetitions;
+
   std::vector<chess::Move> all_possible_moves;
   bool king_under_attack = false;
 
@@ -53,7 +63,7 @@ class ChessGame : public ChessView {
   bool is_bot_turn();
   bool is_player_playing();
 
-  void make_move(chess::Move move, chess::Piece promotion);
+  void make_move(chess::Move move);
 
   void on_turn_begin();
   void on_turn_begin_no_history();
@@ -37,12 +37,11 @@ void WaitingForPlayerView::on_update() {
   if (!player_move) {
     const auto chess_game = chess_views.chess_game;
 
-    if ((player_move =
-           chess_game->bot_integration->get_best_move(chess_game->all_possible_moves))) {
-      const auto& move = player_move->move;
+    if ((player_move = chess_game->bot_integration->get_best_move())) {
+      const auto move = *player_move;
 
-      chess_game->state.last_move = {move.from, move.to};
-      chess_game->hidden_position = move.from;
+      chess_game->state.last_move = {move.from(), move.to()};
+      chess_game->hidden_position = move.from();
 
       const auto map_coords = [&](chess::Position position) {
         const auto field_size = float(chess_game->board_field_size);
@@ -55,8 +54,8 @@ void WaitingForPlayerView::on_update() {
         return std::pair{x, y};
       };
 
-      std::tie(animation_start_x, animation_start_y) = map_coords(move.from);
-      std::tie(animation_end_x, animation_end_y) = map_coords(move.to);
+      std::tie(animation_start_x, animation_start_y) = map_coords(move.from());
+      std::tie(animation_end_x, animation_end_y) = map_coords(move.to());
 
       animation_start_t = get_current_time();
       animation_end_t = get_current_time() + 0.12f;
@@ -76,7 +75,7 @@ void WaitingForPlayerView::on_render() {
     const auto x = std::lerp(animation_start_x, animation_end_x, t);
     const auto y = std::lerp(animation_start_y, animation_end_y, t);
 
-    const auto field = chess_views.chess_game->state.board.get_field(player_move->move.from);
+    const auto field = chess_views.chess_game->state.board.get_field(player_move->from());
     piece_renderer.draw_piece(field.color, field.piece, int(x), int(y),
                               chess_views.chess_game->size_token);
   }
@@ -6,7 +6,7 @@
 #include <optional>
 
 class WaitingForPlayerView : public ChessView {
-  std::optional<chess::PlayerMove> player_move;
+  std::optional<chess::Move> player_move;
 
   sf::Clock clock;
 
@@ -26,7 +26,7 @@ class WaitingForPlayerView : public ChessView {
 public:
   using ChessView::ChessView;
 
-  std::optional<chess::PlayerMove> get_player_move() { return player_move; }
+  std::optional<chess::Move> get_player_move() { return player_move; }
   bool was_interrupted() const { return interrupted; }
 
   void update_cursor_position(int x, int y) override;
@@ -0,0 +1,44 @@
+#pragma once
+#include <chess/Board.hpp>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+struct BenchmarkPosition {
+  chess::Board board;
+  chess::Color player_turn;
+};
+
+/// Collects positions from random games played from the starting position. The generator is
+/// seeded with `seed`, so every run measures exactly the same positions.
+inline std::vector<BenchmarkPosition> generate_benchmark_positions(size_t count, uint32_t seed) {
+  using namespace chess;
+
+  std::vector<BenchmarkPosition> positions;
+  std::mt19937 random(seed);
+
+  Board board;
+  Color player_turn = Color::White;
+  int ply = 0;
+
+  while (positions.size() < count) {
+    MoveList moves;
+    board.calculate_legal_moves(player_turn, moves);
+
+    if (moves.empty() || board.is_material_insufficient() || ply >= 120) {
+      board = Board();
+      player_turn = Color::White;
+      ply = 0;
+      continue;
+    }
+
+    board.make_move(moves[random() % moves.size()]);
+    player_turn = other_color(player_turn);
+    ply++;
+
+    positions.push_back(BenchmarkPosition{board, player_turn});
+  }
+
+  return positions;
+}
\ No newline at end of file
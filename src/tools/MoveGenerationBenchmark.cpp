@@ -0,0 +1,147 @@
+#include "BenchmarkPositions.hpp"
+#include "Perft.hpp"
+#include <chess/Board.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace chess;
+
+static uint64_t run_move_generation(const std::vector<BenchmarkPosition>& positions,
+                                    uint64_t& generated) {
+  uint64_t checksum = 0;
+
+  for (const auto& position : positions) {
+    MoveList moves;
+    position.board.calculate_legal_moves(position.player_turn, moves);
+
+    for (const auto move : moves) {
+      checksum = checksum * 31 + move.raw();
+    }
+
+    generated += moves.size();
+  }
+
+  return checksum;
+}
+
+static uint64_t run_move_counting(const std::vector<BenchmarkPosition>& positions) {
+  uint64_t counted = 0;
+
+  for (const auto& position : positions) {
+    counted += position.board.count_legal_moves(position.player_turn);
+  }
+
+  return counted;
+}
+
+/// Makes and unmakes every legal move in every position.
+static uint64_t run_make_unmake(std::vector<BenchmarkPosition>& positions, uint64_t& made) {
+  uint64_t checksum = 0;
+
+  for (auto& position : positions) {
+    MoveList moves;
+    position.board.calculate_legal_moves(position.player_turn, moves);
+
+    for (const auto move : moves) {
+      const auto undo = position.board.make_move(move);
+      checksum += position.board.get_hash();
+      position.board.unmake_move(undo);
+    }
+
+    made += moves.size();
+  }
+
+  return checksum;
+}
+
+/// Tests every legal move in every position for giving check.
+static uint64_t run_gives_check(const std::vector<BenchmarkPosition>& positions, uint64_t& tested) {
+  uint64_t checks = 0;
+
+  for (const auto& position : positions) {
+    MoveList moves;
+    position.board.calculate_legal_moves(position.player_turn, moves);
+
+    const auto info = position.board.get_check_info(position.player_turn);
+
+    for (const auto move : moves) {
+      checks += position.board.gives_check(move, info);
+    }
+
+    tested += moves.size();
+  }
+
+  return checks;
+}
+
+/// Returns the time of the fastest run, which is the least affected by other processes.
+template <typename Fn> static double measure(int runs, Fn&& fn) {
+  double best_time = 0.0;
+
+  for (int i = 0; i < runs; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const auto end = std::chrono::steady_clock::now();
+
+    const auto time = std::chrono::duration<double>(end - start).count();
+    if (i == 0 || time < best_time) {
+      best_time = time;
+    }
+  }
+
+  return best_time;
+}
+
+int main() {
+  constexpr int runs = 10;
+  auto positions = generate_benchmark_positions(20000, 4321);
+
+  std::printf("Benchmarking move generation on %zu positions.\n\n", positions.size());
+
+  uint64_t generated = 0;
+  uint64_t generation_checksum = 0;
+  const auto generation_time = measure(runs, [&] {
+    generated = 0;
+    generation_checksum = run_move_generation(positions, generated);
+  });
+
+  std::printf("generation    %12.0f moves/s  (checksum %016llx)\n",
+              double(generated) / generation_time, (unsigned long long)generation_checksum);
+
+  uint64_t counted = 0;
+  const auto counting_time = measure(runs, [&] { counted = run_move_counting(positions); });
+
+  std::printf("counting      %12.0f moves/s  (%llu moves)\n", double(counted) / counting_time,
+              (unsigned long long)counted);
+
+  uint64_t made = 0;
+  uint64_t make_checksum = 0;
+  const auto make_time = measure(runs, [&] {
+    made = 0;
+    make_checksum = run_make_unmake(positions, made);
+  });
+
+  std::printf("make/unmake   %12.0f moves/s  (checksum %016llx)\n", double(made) / make_time,
+              (unsigned long long)make_checksum);
+
+  uint64_t tested = 0;
+  uint64_t checks = 0;
+  const auto check_time = measure(runs, [&] {
+    tested = 0;
+    checks = run_gives_check(positions, tested);
+  });
+
+  std::printf("gives check   %12.0f moves/s  (%llu checks)\n", double(tested) / check_time,
+              (unsigned long long)checks);
+
+  Board board;
+  uint64_t nodes = 0;
+  const auto perft_time = measure(3, [&] { nodes = perft(board, Color::White, 6); });
+
+  std::printf("perft 6       %12.0f nodes/s  (%llu nodes)\n", double(nodes) / perft_time,
+              (unsigned long long)nodes);
+
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,305 @@
+#include "Perft.hpp"
+#include <chess/Board.hpp>
+#include <chess/Notation.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace chess;
+
+struct SuitePosition {
+  const char* name;
+  const char* fen;
+  int depth;
+  uint64_t nodes;
+};
+
+/// Standard perft positions with their node counts at the given depth. Together they cover
+/// castling, en passant (including discovered checks), promotions and checks.
+constexpr SuitePosition suite[] = {
+  {"start", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 6, 119060324},
+  {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5,
+   193690690},
+  {"position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 7, 178633661},
+  {"position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292},
+  {"position 4 mirrored", "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", 5,
+   15833292},
+  {"position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 5, 89941194},
+  {"position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 5,
+   164075551},
+};
+
+struct PerftSettings {
+  size_t threads = 1;
+
+  /// Size of the cache in megabytes, 0 disables it.
+  size_t cache_size = 0;
+};
+
+struct RootMoveNodes {
+  Move move;
+  uint64_t nodes = 0;
+};
+
+/// Counts leaf nodes after every root move. Subtrees after the first two moves are split between
+/// `settings.threads` threads, which gives them enough pieces of work to stay busy even if a few
+/// root moves have most of the nodes.
+static std::vector<RootMoveNodes> perft_root(const FenPosition& position, int depth,
+                                             const PerftSettings& settings) {
+  const auto player_turn = position.player_turn;
+  const auto opponent = other_color(player_turn);
+
+  std::unique_ptr<PerftCache> cache;
+  if (settings.cache_size > 0) {
+    cache = std::make_unique<PerftCache>(settings.cache_size);
+  }
+
+  struct Task {
+    Board board;
+    size_t root_index;
+    uint64_t nodes = 0;
+  };
+
+  std::vector<RootMoveNodes> result;
+  std::vector<Task> tasks;
+
+  auto board = position.board;
+
+  MoveList moves;
+  board.calculate_legal_moves(player_turn, moves);
+
+  for (const auto move : moves) {
+    const auto root_index = result.size();
+    result.push_back(RootMoveNodes{move});
+
+    const auto undo = board.make_move(move);
+
+    if (depth <= 2) {
+      result.back().nodes = perft(board, opponent, depth - 1, nullptr);
+    } else {
+      MoveList replies;
+      board.calculate_legal_moves(opponent, replies);
+
+      for (const auto reply : replies) {
+        const auto reply_undo = board.make_move(reply);
+        tasks.push_back(Task{board, root_index});
+        board.unmake_move(reply_undo);
+      }
+    }
+
+    board.unmake_move(undo);
+  }
+
+  std::atomic_size_t next_task = 0;
+
+  const auto worker = [&] {
+    while (true) {
+      const size_t index = next_task.fetch_add(1);
+      if (index >= tasks.size()) {
+        break;
+      }
+
+      auto& task = tasks[index];
+      task.nodes = perft(task.board, player_turn, depth - 2, cache.get());
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < settings.threads; ++i) {
+    threads.emplace_back(worker);
+  }
+
+  worker();
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (const auto& task : tasks) {
+    result[task.root_index].nodes += task.nodes;
+  }
+
+  return result;
+}
+
+static uint64_t perft(const FenPosition& position, int depth, const PerftSettings& settings) {
+  uint64_t nodes = 0;
+
+  for (const auto& root_move : perft_root(position, depth, settings)) {
+    nodes += root_move.nodes;
+  }
+
+  return nodes;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// Prints the number of leaf nodes after every root move, then the total.
+static void divide(const FenPosition& position, int depth, const PerftSettings& settings) {
+  const auto start = std::chrono::steady_clock::now();
+  const auto root_moves = perft_root(position, depth, settings);
+  const auto time = seconds_since(start);
+
+  uint64_t total = 0;
+
+  for (const auto& root_move : root_moves) {
+    char buffer[notation::max_uci_length];
+    notation::write_uci(root_move.move, buffer);
+
+    std::printf("%s: %llu\n", buffer,
+                (unsigned long long)root_move.nodes);
+
+    total += root_move.nodes;
+  }
+
+  std::printf("\nmoves: %zu\nnodes: %llu\ntime: %.3f s\nnps: %.0f\n", root_moves.size(),
+              (unsigned long long)total, time, double(total) / time);
+}
+
+/// Measures the position with 1 thread, then with doubled thread counts up to `max_threads`.
+/// Every run starts with an empty cache.
+static void report_scaling(const FenPosition& position, int depth, PerftSettings settings,
+                           size_t max_threads) {
+  double single_thread_time = 0.0;
+
+  std::printf("threads  %12s  %9s  %12s  speedup\n", "nodes", "time", "nps");
+
+  for (size_t threads = 1;; threads = std::min(threads * 2, max_threads)) {
+    settings.threads = threads;
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto nodes = perft(position, depth, settings);
+    const auto time = seconds_since(start);
+
+    if (threads == 1) {
+      single_thread_time = time;
+    }
+
+    std::printf("%7zu  %12llu  %7.3f s  %12.0f  %6.2fx\n", threads, (unsigned long long)nodes,
+                time, double(nodes) / time, single_thread_time / time);
+
+    if (threads == max_threads) {
+      break;
+    }
+  }
+}
+
+/// Runs every suite position and returns false if any node count differs from the expected one.
+static bool run_suite(const PerftSettings& settings) {
+  bool passed = true;
+  uint64_t total_nodes = 0;
+  double total_time = 0.0;
+
+  for (const auto& entry : suite) {
+    const auto position = *Board::from_fen(entry.fen);
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto nodes = perft(position, entry.depth, settings);
+    const auto time = seconds_since(start);
+
+    const bool ok = nodes == entry.nodes;
+    passed &= ok;
+
+    std::printf("%-20s depth %d  %12llu nodes  %7.3f s  %12.0f nps  %s\n", entry.name, entry.depth,
+                (unsigned long long)nodes, time, double(nodes) / time, ok ? "ok" : "FAILED");
+
+    if (!ok) {
+      std::printf("  expected %llu nodes\n", (unsigned long long)entry.nodes);
+    }
+
+    total_nodes += nodes;
+    total_time += time;
+  }
+
+  std::printf("\n%llu nodes in %.3f s (%.0f nps): %s\n", (unsigned long long)total_nodes,
+              total_time, double(total_nodes) / total_time, passed ? "passed" : "FAILED");
+
+  return passed;
+}
+
+static void print_usage(const char* program) {
+  std::printf("Usage: %s [options] [<depth> [fen]]\n"
+              "\n"
+              "Without a depth runs the built-in suite of standard positions. With a depth prints\n"
+              "node counts after every root move (divide) of the given position.\n"
+              "\n"
+              "Options:\n"
+              "  --threads <n>   number of threads (default 1)\n"
+              "  --hash <mb>     size of the shared node count cache in megabytes (default 0)\n"
+              "  --scaling       measure the position with 1 up to --threads threads (default all\n"
+              "                  cores)\n",
+              program);
+}
+
+int main(int argc, char** argv) {
+  PerftSettings settings;
+  size_t threads = 0;
+  bool scaling = false;
+
+  int arg = 1;
+  for (; arg < argc && std::strncmp(argv[arg], "--", 2) == 0; ++arg) {
+    const bool has_value = arg + 1 < argc;
+
+    if (std::strcmp(argv[arg], "--threads") == 0 && has_value) {
+      threads = std::max(std::atoi(argv[++arg]), 1);
+    } else if (std::strcmp(argv[arg], "--hash") == 0 && has_value) {
+      settings.cache_size = std::max(std::atoi(argv[++arg]), 0);
+    } else if (std::strcmp(argv[arg], "--scaling") == 0) {
+      scaling = true;
+    } else {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  settings.threads = threads > 0 ? threads : 1;
+
+  if (arg == argc && !scaling) {
+    return run_suite(settings) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  const int depth = arg < argc ? std::atoi(argv[arg++]) : 6;
+  if (depth < 1) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // FEN may be passed unquoted, in which case its parts are separate arguments.
+  std::string fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+  if (arg < argc) {
+    fen = argv[arg];
+    for (int i = arg + 1; i < argc; ++i) {
+      fen += ' ';
+      fen += argv[i];
+    }
+  }
+
+  FenError error;
+  const auto position = Board::from_fen(fen, &error);
+  if (!position) {
+    std::printf("Invalid FEN (%s at offset %zu): %s\n", error.message, error.offset, fen.c_str());
+    return EXIT_FAILURE;
+  }
+
+  if (scaling) {
+    const size_t max_threads =
+      threads > 0 ? threads : std::max(std::thread::hardware_concurrency(), 1u);
+
+    report_scaling(*position, depth, settings, max_threads);
+  } else {
+    divide(*position, depth, settings);
+  }
+
+  return EXIT_SUCCESS;
+}
\ No newline at end of file
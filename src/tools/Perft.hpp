@@ -0,0 +1,93 @@
+#pragma once
+#include <chess/Board.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+/// Node counts of already visited subtrees, keyed by position hash and depth. It's shared by all
+/// threads without locks: the key is stored xored with the data, so an entry torn by two threads
+/// writing at once doesn't verify and is treated as a miss.
+class PerftCache {
+  struct Entry {
+    std::atomic_uint64_t key = 0;
+    std::atomic_uint64_t data = 0;
+  };
+
+  /// Data packs the node count above the depth.
+  constexpr static int depth_bits = 8;
+
+  std::unique_ptr<Entry[]> entries;
+  size_t mask = 0;
+
+public:
+  explicit PerftCache(size_t megabytes) {
+    // Largest power of 2 number of entries which fits in the given size.
+    size_t count = 1;
+    while (count * 2 * sizeof(Entry) <= megabytes * 1024 * 1024) {
+      count *= 2;
+    }
+
+    entries = std::make_unique<Entry[]>(count);
+    mask = count - 1;
+  }
+
+  std::optional<uint64_t> probe(uint64_t hash, int depth) const {
+    const auto& entry = entries[hash & mask];
+
+    const auto data = entry.data.load(std::memory_order_relaxed);
+    const auto key = entry.key.load(std::memory_order_relaxed);
+
+    if ((key ^ data) != hash || int(data & ((1 << depth_bits) - 1)) != depth) {
+      return std::nullopt;
+    }
+
+    return data >> depth_bits;
+  }
+
+  void store(uint64_t hash, int depth, uint64_t nodes) {
+    auto& entry = entries[hash & mask];
+    const auto data = (nodes << depth_bits) | uint64_t(depth);
+
+    entry.key.store(hash ^ data, std::memory_order_relaxed);
+    entry.data.store(data, std::memory_order_relaxed);
+  }
+};
+
+/// Counts leaf nodes `depth` moves ahead. Moves at the last level are counted, not generated.
+/// Subtrees are looked up in and added to `cache` if it isn't null.
+inline uint64_t perft(chess::Board& board, chess::Color player_turn, int depth,
+                      PerftCache* cache = nullptr) {
+  if (depth == 0) {
+    return 1;
+  }
+
+  if (depth == 1) {
+    return board.count_legal_moves(player_turn);
+  }
+
+  if (cache) {
+    if (const auto nodes = cache->probe(board.get_hash(), depth)) {
+      return *nodes;
+    }
+  }
+
+  chess::MoveList moves;
+  board.calculate_legal_moves(player_turn, moves);
+
+  uint64_t nodes = 0;
+
+  for (const auto move : moves) {
+    const auto undo = board.make_move(move);
+    nodes += perft(board, chess::other_color(player_turn), depth - 1, cache);
+    board.unmake_move(undo);
+  }
+
+  if (cache) {
+    cache->store(board.get_hash(), depth, nodes);
+  }
+
+  return nodes;
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "BenchmarkPositions.hpp"
+#include <chess/Attacks.hpp>
+#include <chess/Board.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace chess;
+
+/// Looks up rook and bishop attacks from every square using occupancy of every position.
+static uint64_t run_lookups(const std::vector<BenchmarkPosition>& positions, uint64_t& lookups) {
+  uint64_t checksum = 0;
+
+  for (const auto& position : positions) {
+    const auto occupied = position.board.get_occupied();
+
+    for (int square = 0; square < 64; ++square) {
+      checksum += attacks::rook(square, occupied);
+      checksum ^= attacks::bishop(square, occupied);
+    }
+
+    lookups += 128;
+  }
+
+  return checksum;
+}
+
+static uint64_t run_move_generation(const std::vector<BenchmarkPosition>& positions,
+                                    uint64_t& generated) {
+  uint64_t checksum = 0;
+
+  for (const auto& position : positions) {
+    MoveList moves;
+    position.board.calculate_legal_moves(position.player_turn, moves);
+
+    for (const auto& move : moves) {
+      checksum = checksum * 31 + move.raw();
+    }
+
+    generated++;
+  }
+
+  return checksum;
+}
+
+template <typename Fn> static double measure(int iterations, Fn&& fn) {
+  const auto start = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < iterations; ++i) {
+    fn();
+  }
+
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+int main() {
+  constexpr int iterations = 20;
+  const auto positions = generate_benchmark_positions(20000, 1234);
+
+  std::printf("Benchmarking slider attacks on %zu positions.\n\n", positions.size());
+
+  const std::pair<attacks::SliderBackend, const char*> backends[] = {
+    {attacks::SliderBackend::Magic, "magic"},
+    {attacks::SliderBackend::Pext, "pext"},
+  };
+
+  const auto default_backend = attacks::get_slider_backend();
+
+  bool first = true;
+  uint64_t expected_lookup_checksum = 0;
+  uint64_t expected_movegen_checksum = 0;
+  bool checksums_match = true;
+
+  for (const auto& [backend, name] : backends) {
+    if (!attacks::set_slider_backend(backend)) {
+      std::printf("%-6s not supported on this CPU\n", name);
+      continue;
+    }
+
+    uint64_t lookups = 0;
+    uint64_t lookup_checksum = 0;
+    const auto lookup_time =
+      measure(iterations, [&] { lookup_checksum = run_lookups(positions, lookups); });
+
+    uint64_t generated = 0;
+    uint64_t movegen_checksum = 0;
+    const auto movegen_time =
+      measure(iterations, [&] { movegen_checksum = run_move_generation(positions, generated); });
+
+    std::printf("%-6s %8.2f ns/lookup %10.0f positions/s (legal move generation)\n", name,
+                lookup_time * 1e9 / double(lookups), double(generated) / movegen_time);
+
+    if (first) {
+      expected_lookup_checksum = lookup_checksum;
+      expected_movegen_checksum = movegen_checksum;
+      first = false;
+    } else if (lookup_checksum != expected_lookup_checksum ||
+               movegen_checksum != expected_movegen_checksum) {
+      checksums_match = false;
+    }
+  }
+
+  attacks::set_slider_backend(default_backend);
+
+  if (!checksums_match) {
+    std::printf("\nBackends produced different results!\n");
+    return 1;
+  }
+
+  return 0;
+}
\ No newline at end of file